@@ -21,15 +21,55 @@ def pick_subdev(u):
 	sys.exit(-1)
 
 
+# typedef enum {
+# 	REP_COMPRESSED,
+# 	REP_NRZ,
+# 	REP_MANCHESTER_STRICT,
+# 	REP_MANCHESTER,
+#	REP_DECODE,
+#	REP_SOFT,
+#	REP_FM0,
+#	REP_DIFF_MANCHESTER,
+#	REP_8B10B
+# } rep_type;
+def rep_index(rep):
+	rep = rep.lower()
+	if rep[0] == 'c':	# compressed
+		return 0
+	elif rep[0] == 'n':	# nrz
+		return 1
+	elif rep[:2] == 'so':	# soft decision
+		return 5
+	elif rep[0] == 's':	# manchester strict
+		return 2
+	elif rep[0] == 'm':	# manchester
+		return 3
+	elif rep[:2] == 'di':	# differential manchester
+		return 7
+	elif rep[0] == 'd':	# decode
+		return 4
+	elif rep[0] == 'f':	# fm0
+		return 6
+	elif rep[0] == '8':	# 8b10b
+		return 8
+	return -1
+
+
 def demod(options):
 
 	graph = gr.top_block();
 	if options.input_file_name is not None:
-		source = file_source = gr.file_source(gr.sizeof_gr_complex, options.input_file_name);
+		if options.short_input:
+			source = file_source = gr.file_source(2 * gr.sizeof_short, options.input_file_name);
+		else:
+			source = file_source = gr.file_source(gr.sizeof_gr_complex, options.input_file_name);
 		if options.clock_speed is None:
 			options.clock_speed = 64e6
 	else:
-		source = usrp.source_c(which = options.which, decim_rate = options.decimation);
+		if options.short_input:
+			source = usrp.source_s(which = options.which, decim_rate = options.decimation);
+		else:
+			source = usrp.source_c(which = options.which, decim_rate = options.decimation);
 		if options.clock_speed is not None:
 			source.set_fpga_master_clock_freq(long(options.clock_speed))
 		else:
@@ -46,31 +86,39 @@ def demod(options):
 			print "Failed to set frequency!";
 			return
 
+	repi = rep_index(options.representation)
+	if repi < 0:
+		print "error: unknown representation"
+		return
+
+	also = []
+	for a in options.also:
+		(rep, sep, filename) = a.partition(':')
+		if not rep or not sep or not filename or rep_index(rep) < 0:
+			print "error: -A takes <representation>:<file>"
+			return
+		also.append((rep_index(rep), filename))
+
 	# typedef enum {
-	# 	REP_COMPRESSED,
-	# 	REP_NRZ,
-	# 	REP_MANCHESTER_STRICT,
-	# 	REP_MANCHESTER,
-	#	REP_DECODE
-	# } rep_type;
-
-	rep = options.representation.lower()
-	if rep[0] == 'c':	# compressed
-		repi = 0
-	elif rep[0] == 'n':	# nrz
-		repi = 1
-	elif rep[0] == 's':	# manchester strict
-		repi = 2
-	elif rep[0] == 'm':	# manchester
-		repi = 3
-	elif rep[0] == 'd':	# decode
-		repi = 4
+	#	THRESHOLD_AVERAGE,
+	#	THRESHOLD_TRACKER,
+	#	THRESHOLD_MATCHED
+	# } threshold_type;
+
+	thresh = options.threshold.lower()
+	if thresh[0] == 'a':	# average
+		threshi = 0
+	elif thresh[0] == 't':	# tracker
+		threshi = 1
+	elif thresh[0] == 'm':	# matched
+		threshi = 2
 	else:
-		print "error: unknown representation"
+		print "error: unknown threshold"
 		return
 
-	demod_sink = omnidemod(options.clock_speed, options.decimation);
+	demod_sink = omnidemod(options.clock_speed, options.decimation, options.short_input);
 	demod_sink.set_representation(repi)
+	demod_sink.set_threshold(threshi)
 	if options.hex:
 		demod_sink.show_hex()
         if options.show_power:
@@ -81,10 +129,51 @@ def demod(options):
 		demod_sink.set_output(options.output_file_name)
 	if options.capture_file is not None:
 		demod_sink.set_capture(options.capture_file)
-
-	graph.connect(source, demod_sink);
+	if options.trace_file is not None:
+		demod_sink.set_trace_file(options.trace_file)
+	if options.snapshot is not None:
+		demod_sink.set_snapshot(options.snapshot, options.snapshot_seconds)
+	if options.validate is not None:
+		demod_sink.set_frame_check(options.validate)
+	if options.invalid_file is not None:
+		demod_sink.set_invalid_output(options.invalid_file)
+	if options.dedup > 0:
+		demod_sink.set_repeat_window(options.dedup)
+	if options.messages > 0:
+		demod_sink.set_reassembly(options.messages)
+	if options.burst_timeout > 0:
+		demod_sink.set_burst_timeout(options.burst_timeout)
+	if options.max_burst > 0:
+		demod_sink.set_max_burst(options.max_burst)
+	for (rep, filename) in also:
+		demod_sink.add_representation(rep, filename)
+	if options.stats_file is not None:
+		demod_sink.set_stats_file(options.stats_file, options.stats_interval)
+
+	if options.input_file_name is None:
+		demod_sink.monitor_realtime(options.max_backlog)
+
+	if options.short_input and options.input_file_name is None:
+		# usrp.source_s produces I and Q as separate items
+		graph.connect(source, gr.stream_to_vector(gr.sizeof_short, 2), demod_sink);
+	else:
+		graph.connect(source, demod_sink);
 	graph.run()
 
+	if options.latency and demod_sink.latency_count() > 0:
+		# typedef enum {
+		#	LATENCY_TOTAL,
+		#	LATENCY_WAIT,
+		#	LATENCY_DECODE,
+		#	LATENCY_WRITE
+		# } latency_type;
+		print "latency over %d bursts (ms):" % demod_sink.latency_count()
+		for (stage, name) in enumerate(["total", "wait", "decode", "write"]):
+			print "\t%-8s p50 %.3f p99 %.3f p999 %.3f" % (name,
+			   1e3 * demod_sink.latency(stage, 0.5),
+			   1e3 * demod_sink.latency(stage, 0.99),
+			   1e3 * demod_sink.latency(stage, 0.999))
+
 
 def main():
 	parser = OptionParser(option_class=eng_option)
@@ -100,10 +189,14 @@ def main():
 	   help = "set gain in dB [0.0, 1.0] (default is midpoint)")
 	parser.add_option("-f", "--input-file-name", type = "string", default = None,
 	   help = "set input to file (defaults to USRP)")
+	parser.add_option("-S", "--short-input", action = "store_true", default = False,
+	   help = "use 16-bit I/Q samples and the fixed-point demodulator; input files are interleaved int16 (default = %default)")
 	parser.add_option("-o", "--output-file-name", type = "string", default = None,
 	   help = "set output to file (defaults to screen)")
 	parser.add_option("-r", "--representation", type = "string", default = "m",
-	   help = "set representation: 'compressed', 'NRZ', 'Manchester', 'StrictManchester', 'Decode' (defaults to 'Manchester')")
+	   help = "set representation: 'compressed', 'NRZ', 'Manchester', 'StrictManchester', 'Decode', 'Soft', 'FM0', 'Differential', '8b10b' (defaults to 'Manchester')")
+	parser.add_option("-t", "--threshold", type = "string", default = "a",
+	   help = "set threshold: 'average', 'tracker', 'matched' (defaults to 'average')")
         parser.add_option("-H", "--hex", action = "store_true", default = False,
            help = "include hex representation of data (default = %default)")
         parser.add_option("-p", "--show-power", action = "store_true", default = False,
@@ -112,6 +205,34 @@ def main():
 	   help = "show starting sample of captured burst (default = %default)")
 	parser.add_option("-c", "--capture-file", type = "string", default = None,
 	   help = "save captured signal bursts in ``filename-clock_speed-decimation.omnidump''")
+	parser.add_option("-T", "--stats-file", type = "string", default = None,
+	   help = "append demodulator counters to file periodically")
+	parser.add_option("-I", "--stats-interval", type = "eng_float", default = 10,
+	   help = "seconds between lines in the stats file (default = %default)")
+	parser.add_option("-x", "--trace-file", type = "string", default = None,
+	   help = "dump recent slicer decisions to file when a burst with a preamble fails to decode")
+	parser.add_option("-X", "--snapshot", type = "string", default = None,
+	   help = "write the raw input leading up to a burst with a preamble that fails to decode to filename-<sample>-<samples>-clock_speed-decimation.omnidump")
+	parser.add_option("-W", "--snapshot-seconds", type = "eng_float", default = 1,
+	   help = "seconds of input in each snapshot (default = %default)")
+	parser.add_option("-B", "--max-backlog", type = "eng_float", default = 0.1,
+	   help = "warn when the USRP input backs up by more than this many seconds (default = %default)")
+	parser.add_option("-l", "--latency", action = "store_true", default = False,
+	   help = "print burst latency percentiles at the end (default = %default)")
+	parser.add_option("-V", "--validate", type = "string", default = None,
+	   help = "frame checks, e.g. 'crc16:1021:ffff:0:0:0:64,markers:0' (see frame_check.h)")
+	parser.add_option("-i", "--invalid-file", type = "string", default = None,
+	   help = "write frames that fail the checks to file rather than dropping them")
+	parser.add_option("-D", "--dedup", type = "eng_float", default = 0,
+	   help = "count bursts repeated within this many seconds rather than decoding them again (default = %default)")
+	parser.add_option("-M", "--messages", type = "eng_float", default = 0,
+	   help = "reassemble messages over several bursts, giving up after this many seconds (default = %default)")
+	parser.add_option("-E", "--burst-timeout", type = "eng_float", default = 0,
+	   help = "end a burst once no transition has come for this many symbols, rather than at the next noise (default = %default)")
+	parser.add_option("-m", "--max-burst", type = "eng_float", default = 1,
+	   help = "decode bursts up to this many seconds long whole (default = %default)")
+	parser.add_option("-A", "--also", type = "string", action = "append", default = [],
+	   help = "also write representation to file, as <representation>:<file>; may be repeated")
 	(options, args) = parser.parse_args()
 
 	# do we still have arguments left over?
@@ -0,0 +1,105 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdexcept>
+#include "burst_cache.h"
+
+
+burst_cache::burst_cache(unsigned int len) {
+
+	burst_cache_entry empty = { 0, 0, 0, 0 };
+
+	if(!len || (len & (len - 1)))
+		throw std::runtime_error("error: burst_cache: length must be a power of 2");
+	m_table.assign(len, empty);
+	m_mask = len - 1;
+	m_window = 0;
+}
+
+
+/*
+ * window is in samples; 0 turns the cache off and forgets what is in it.
+ */
+void burst_cache::set_window(unsigned long long window) {
+
+	burst_cache_entry empty = { 0, 0, 0, 0 };
+
+	m_window = window;
+	m_table.assign(m_table.size(), empty);
+}
+
+
+int burst_cache::enabled() {
+
+	return m_window != 0;
+}
+
+
+/*
+ * The entry for an earlier copy of a burst starting at sample, or 0.
+ */
+burst_cache_entry *burst_cache::find(unsigned long long hash, unsigned long long sample) {
+
+	unsigned int i;
+	burst_cache_entry *e;
+
+	for(i = 0; i < m_probe; i++) {
+		e = &m_table[(hash + i) & m_mask];
+		if(e->hash == hash && live(*e, sample))
+			return e;
+	}
+	return 0;
+}
+
+
+/*
+ * Returns 1 if a live entry had to be evicted to make room.
+ */
+int burst_cache::insert(unsigned long long hash, unsigned long long sample, int invalid) {
+
+	unsigned int i;
+	burst_cache_entry *e, *oldest = 0;
+
+	for(i = 0; i < m_probe; i++) {
+		e = &m_table[(hash + i) & m_mask];
+		if(!live(*e, sample)) {
+			oldest = e;
+			break;
+		}
+		if(!oldest || e->first < oldest->first)
+			oldest = e;
+	}
+	i = live(*oldest, sample);
+
+	oldest->hash = hash;
+	oldest->first = sample;
+	oldest->repeats = 0;
+	oldest->invalid = invalid;
+	return i;
+}
+
+
+/*
+ * 64-bit FNV-1a.
+ */
+unsigned long long burst_cache::hash(const unsigned char *buf, unsigned int len) {
+
+	unsigned long long h = 14695981039346656037ULL;
+	unsigned int i;
+
+	for(i = 0; i < len; i++) {
+		h ^= buf[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+
+/*
+ * A hash of 0 marks an empty slot.
+ */
+int burst_cache::live(const burst_cache_entry &e, unsigned long long sample) {
+
+	return e.hash && e.first <= sample && sample - e.first < m_window;
+}
@@ -0,0 +1,43 @@
+#ifndef INCLUDED_BURST_CACHE_H
+#define INCLUDED_BURST_CACHE_H
+
+/*
+ * burst_cache
+ *
+ * Bursts seen recently, by a hash of their symbols, so that a retransmission
+ * can be counted against the first copy instead of being decoded and written
+ * again.  An entry lasts for a window of samples from the first copy.  The
+ * table is a power of 2 long and a hash may sit in any of m_probe slots from
+ * its home; when they are all live the oldest is evicted.
+ */
+
+#include <vector>
+
+struct burst_cache_entry {
+	unsigned long long	hash;
+	unsigned long long	first;		// starting sample of the first copy
+	unsigned int		repeats;	// copies since
+	int			invalid;	// the first copy failed the frame checks
+};
+
+class burst_cache {
+public:
+	burst_cache(unsigned int len = 64);
+
+	void set_window(unsigned long long window);
+	int enabled();
+	burst_cache_entry *find(unsigned long long hash, unsigned long long sample);
+	int insert(unsigned long long hash, unsigned long long sample, int invalid);
+
+	static unsigned long long hash(const unsigned char *buf, unsigned int len);
+
+private:
+	static const unsigned int m_probe = 4;
+
+	std::vector<burst_cache_entry> m_table;
+	unsigned int		m_mask;
+	unsigned long long	m_window;	// samples, 0 for off
+
+	int live(const burst_cache_entry &e, unsigned long long sample);
+};
+#endif /* INCLUDED_BURST_CACHE_H */
@@ -0,0 +1,205 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+#include <vector>
+#include "frame_check.h"
+
+
+static unsigned int reflect(unsigned int v, unsigned int width) {
+
+	unsigned int i, r = 0;
+
+	for(i = 0; i < width; i++, v >>= 1)
+		r = (r << 1) | (v & 1);
+	return r;
+}
+
+
+frame_check::frame_check() {
+
+	configure("");
+}
+
+
+/*
+ * Replaces any checks set before; an empty spec turns them all off.
+ */
+void frame_check::configure(const char *spec) {
+
+	std::vector<char> copy(spec, spec + strlen(spec) + 1);
+	unsigned int width, poly, init, xorout, first, last, min, max;
+	int reflected, n;
+	char *item, *save;
+
+	m_crc = 0;
+	m_min_bits = 0;
+	m_max_bits = 0;
+	m_markers = 0;
+	m_max_markers = 0;
+
+	for(item = strtok_r(&copy[0], ",", &save); item; item = strtok_r(0, ",", &save)) {
+		if(sscanf(item, "crc%u:%x:%x:%d:%x:%u:%u%n", &width, &poly, &init, &reflected, &xorout, &first, &last, &n) == 7 && !item[n]) {
+			set_crc(width, poly, init, reflected, xorout, first, last);
+		} else if(sscanf(item, "length:%u:%u%n", &min, &max, &n) == 2 && !item[n]) {
+			m_min_bits = min;
+			m_max_bits = max;
+		} else if(sscanf(item, "markers:%u%n", &max, &n) == 1 && !item[n]) {
+			m_markers = 1;
+			m_max_markers = max;
+		} else
+			throw std::runtime_error("error: frame_check: bad check in spec");
+	}
+}
+
+
+void frame_check::set_crc(unsigned int width, unsigned int poly, unsigned int init, int reflected, unsigned int xorout, unsigned int first, unsigned int last) {
+
+	unsigned int i, j, k, c, p;
+
+	if(width < 1 || width > 32)
+		throw std::runtime_error("error: frame_check: CRC width must be 1 to 32");
+	if(first >= last)
+		throw std::runtime_error("error: frame_check: CRC covers no bits");
+
+	m_crc = 1;
+	m_width = width;
+	m_poly = poly;
+	m_init = init;
+	m_reflect = reflected;
+	m_xorout = xorout;
+	m_first = first;
+	m_last = last;
+
+	/*
+	 * Unreflected the register is kept in the top width bits, so one table
+	 * serves every width; reflected it is in the bottom width bits.
+	 */
+	if(m_reflect) {
+		p = reflect(m_poly, m_width);
+		for(i = 0; i < 256; i++) {
+			for(c = i, j = 0; j < 8; j++)
+				c = (c & 1)? (c >> 1) ^ p : c >> 1;
+			m_table[0][i] = c;
+		}
+		for(k = 1; k < 8; k++)
+			for(i = 0; i < 256; i++)
+				m_table[k][i] = (m_table[k - 1][i] >> 8) ^ m_table[0][m_table[k - 1][i] & 0xff];
+	} else {
+		p = m_poly << (32 - m_width);
+		for(i = 0; i < 256; i++) {
+			for(c = i << 24, j = 0; j < 8; j++)
+				c = (c & 0x80000000)? (c << 1) ^ p : c << 1;
+			m_table[0][i] = c;
+		}
+		for(k = 1; k < 8; k++)
+			for(i = 0; i < 256; i++)
+				m_table[k][i] = (m_table[k - 1][i] << 8) ^ m_table[0][m_table[k - 1][i] >> 24];
+	}
+}
+
+
+int frame_check::enabled() {
+
+	return m_crc || m_min_bits || m_max_bits || m_markers;
+}
+
+
+/*
+ * bits are '0' and '1' in the order received; markers is the number of
+ * decoding errors in the frame.  Returns 1 if the frame passes.
+ */
+int frame_check::check(const char *bits, unsigned int nbits, unsigned int markers) {
+
+	if(m_markers && markers > m_max_markers)
+		return 0;
+	if(nbits < m_min_bits || (m_max_bits && nbits > m_max_bits))
+		return 0;
+	if(m_crc) {
+		if(nbits < m_last + m_width)
+			return 0;
+		if(crc(bits + m_first, m_last - m_first) != field(bits + m_last, m_width))
+			return 0;
+	}
+	return 1;
+}
+
+
+/*
+ * The CRC of nbits bits.  Bits in front of the last whole byte boundary are
+ * shifted in one at a time so the rest falls on bytes.
+ */
+unsigned int frame_check::crc(const char *bits, unsigned int nbits) {
+
+	unsigned int i, j, c, p, x, lead = nbits % 8, nbytes = nbits / 8;
+	std::vector<unsigned char> b(nbytes + 8);
+	const unsigned char *q;
+
+	if(m_reflect) {
+		p = reflect(m_poly, m_width);
+		c = reflect(m_init, m_width);
+		for(i = 0; i < lead; i++) {
+			c ^= bits[i] == '1';
+			c = (c & 1)? (c >> 1) ^ p : c >> 1;
+		}
+	} else {
+		p = m_poly << (32 - m_width);
+		c = m_init << (32 - m_width);
+		for(i = 0; i < lead; i++) {
+			c ^= (unsigned int)(bits[i] == '1') << 31;
+			c = (c & 0x80000000)? (c << 1) ^ p : c << 1;
+		}
+	}
+
+	// the first bit of each byte is the one the table takes first
+	for(i = 0; i < nbytes; i++) {
+		for(x = 0, j = 0; j < 8; j++) {
+			if(bits[lead + 8 * i + j] == '1')
+				x |= m_reflect? 1 << j : 0x80 >> j;
+		}
+		b[i] = x;
+	}
+
+	q = &b[0];
+	if(m_reflect) {
+		for(i = 0; i + 8 <= nbytes; i += 8, q += 8) {
+			x = c ^ (q[0] | (q[1] << 8) | (q[2] << 16) | ((unsigned int)q[3] << 24));
+			c = m_table[7][x & 0xff] ^ m_table[6][(x >> 8) & 0xff] ^ m_table[5][(x >> 16) & 0xff] ^ m_table[4][x >> 24] ^
+			   m_table[3][q[4]] ^ m_table[2][q[5]] ^ m_table[1][q[6]] ^ m_table[0][q[7]];
+		}
+		for(; i < nbytes; i++, q++)
+			c = (c >> 8) ^ m_table[0][(c ^ *q) & 0xff];
+		c ^= m_xorout;
+	} else {
+		for(i = 0; i + 8 <= nbytes; i += 8, q += 8) {
+			x = c ^ (((unsigned int)q[0] << 24) | (q[1] << 16) | (q[2] << 8) | q[3]);
+			c = m_table[7][x >> 24] ^ m_table[6][(x >> 16) & 0xff] ^ m_table[5][(x >> 8) & 0xff] ^ m_table[4][x & 0xff] ^
+			   m_table[3][q[4]] ^ m_table[2][q[5]] ^ m_table[1][q[6]] ^ m_table[0][q[7]];
+		}
+		for(; i < nbytes; i++, q++)
+			c = (c << 8) ^ m_table[0][(c >> 24) ^ *q];
+		c = (c >> (32 - m_width)) ^ m_xorout;
+	}
+
+	return (m_width < 32)? c & ((1U << m_width) - 1) : c;
+}
+
+
+/*
+ * A CRC as sent: most significant bit first, or least if reflected.
+ */
+unsigned int frame_check::field(const char *bits, unsigned int width) {
+
+	unsigned int i, v = 0;
+
+	for(i = 0; i < width; i++) {
+		if(m_reflect)
+			v |= (unsigned int)(bits[i] == '1') << i;
+		else
+			v = (v << 1) | (bits[i] == '1');
+	}
+	return v;
+}
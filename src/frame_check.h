@@ -0,0 +1,53 @@
+#ifndef INCLUDED_FRAME_CHECK_H
+#define INCLUDED_FRAME_CHECK_H
+
+/*
+ * frame_check
+ *
+ * Checks on the data bits after a preamble, made before a burst is formatted
+ * or saved.  Configured from a spec of comma-separated checks:
+ *
+ *	crc<width>:<poly>:<init>:<reflect>:<xorout>:<first>:<last>
+ *		CRC of bits first to last - 1 must equal the width bits that
+ *		follow them.  poly, init and xorout are hex, in the usual
+ *		(unreflected) form; reflect 1 takes each byte least
+ *		significant bit first, as CRC-32 does.  width is 1 to 32.
+ *	length:<min>:<max>
+ *		bits in the frame; a max of 0 is no limit.
+ *	markers:<max>
+ *		decoding errors the frame may contain.
+ *
+ * e.g. "crc16:1021:ffff:0:0:0:64,markers:0".  The CRC is table driven,
+ * slicing by 8 bytes, with any bits short of a whole byte at the start done
+ * one at a time.
+ */
+
+class frame_check {
+public:
+	frame_check();
+
+	void configure(const char *spec);
+	int enabled();
+	int check(const char *bits, unsigned int nbits, unsigned int markers);
+	unsigned int crc(const char *bits, unsigned int nbits);
+
+private:
+	int		m_crc;			// CRC check configured
+	unsigned int	m_width;
+	unsigned int	m_poly;
+	unsigned int	m_init;
+	int		m_reflect;
+	unsigned int	m_xorout;
+	unsigned int	m_first;		// bits covered
+	unsigned int	m_last;
+	unsigned int	m_table[8][256];	// slicing-by-8
+
+	unsigned int	m_min_bits;
+	unsigned int	m_max_bits;		// 0 for no limit
+	int		m_markers;		// markers check configured
+	unsigned int	m_max_markers;
+
+	void set_crc(unsigned int width, unsigned int poly, unsigned int init, int reflected, unsigned int xorout, unsigned int first, unsigned int last);
+	unsigned int field(const char *bits, unsigned int width);
+};
+#endif /* INCLUDED_FRAME_CHECK_H */
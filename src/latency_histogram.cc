@@ -0,0 +1,80 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <math.h>
+#include "latency_histogram.h"
+
+
+latency_histogram::latency_histogram() {
+
+	reset();
+}
+
+
+/*
+ * Bucket 0 holds everything under 1us; bucket i > 0 holds
+ * [2^((i - 1) / m_per_octave), 2^(i / m_per_octave)) us.
+ */
+void latency_histogram::add(double seconds) {
+
+	double us = seconds * 1e6;
+	unsigned int i = 0;
+
+	if(us >= 1) {
+		i = (unsigned int)(log2(us) * m_per_octave) + 1;
+		if(i >= m_nbuckets)
+			i = m_nbuckets - 1;
+	}
+	m_bucket[i] += 1;
+	m_count += 1;
+	if(seconds > m_max)
+		m_max = seconds;
+}
+
+
+void latency_histogram::reset() {
+
+	memset(m_bucket, 0, sizeof(m_bucket));
+	m_count = 0;
+	m_max = 0;
+}
+
+
+unsigned long long latency_histogram::count() {
+
+	return m_count;
+}
+
+
+/*
+ * The upper edge of the bucket holding the p quantile, 0 <= p <= 1, in
+ * seconds.  Never more than the largest value seen.
+ */
+double latency_histogram::percentile(double p) {
+
+	unsigned long long n, want;
+	unsigned int i;
+	double edge;
+
+	if(!m_count)
+		return 0;
+
+	want = (unsigned long long)ceil(p * m_count);
+	if(want < 1)
+		want = 1;
+	for(n = 0, i = 0; i < m_nbuckets - 1; i++) {
+		if((n += m_bucket[i]) >= want)
+			break;
+	}
+
+	edge = pow(2.0, (double)i / m_per_octave) / 1e6;
+	return (edge < m_max)? edge : m_max;
+}
+
+
+double latency_histogram::max() {
+
+	return m_max;
+}
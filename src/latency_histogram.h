@@ -0,0 +1,30 @@
+#ifndef INCLUDED_LATENCY_HISTOGRAM_H
+#define INCLUDED_LATENCY_HISTOGRAM_H
+
+/*
+ * latency_histogram
+ *
+ * Durations in log-spaced buckets, m_per_octave to each doubling, from 1us
+ * up.  Adding a value is a log2() and an increment; percentiles are good to
+ * the width of a bucket (about 19%).
+ */
+
+class latency_histogram {
+public:
+	latency_histogram();
+
+	void add(double seconds);
+	void reset();
+	unsigned long long count();
+	double percentile(double p);
+	double max();
+
+private:
+	static const unsigned int m_per_octave = 4;
+	static const unsigned int m_nbuckets = 32 * m_per_octave;	// 1us to over an hour
+
+	unsigned long long	m_bucket[m_nbuckets];
+	unsigned long long	m_count;
+	double			m_max;
+};
+#endif /* INCLUDED_LATENCY_HISTOGRAM_H */
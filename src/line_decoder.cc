@@ -0,0 +1,205 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <vector>
+#include "line_decoder.h"
+
+
+line_decoder::~line_decoder() {
+}
+
+
+/*
+ * Tables by previous symbol, first symbol, second symbol.
+ */
+static table_decoder manchester("manchester", "X01XX01X");
+static table_decoder fm0("fm0", "XX01" "10XX");
+static table_decoder differential("differential", "X01XX10X");
+static decoder_8b10b eight_ten("8b10b", &manchester);
+
+static line_decoder *decoders[] = {&manchester, &fm0, &differential, &eight_ten};
+
+
+line_decoder *line_decoder::find(const char *name) {
+
+	unsigned int i;
+
+	for(i = 0; i < sizeof(decoders) / sizeof(*decoders); i++)
+		if(!strcmp(decoders[i]->name(), name))
+			return decoders[i];
+	return 0;
+}
+
+
+table_decoder::table_decoder(const char *name, const char *table) {
+
+	m_name = name;
+	memcpy(m_table, table, sizeof(m_table));
+}
+
+
+const char *table_decoder::name() {
+
+	return m_name;
+}
+
+
+unsigned int table_decoder::decode(const unsigned char *symbols, unsigned int nsymbols, int prev, char *bits, unsigned int max_bits) {
+
+	unsigned int i, n;
+
+	for(i = 0, n = 0; i + 1 < nsymbols && n < max_bits; i += 2) {
+		bits[n++] = m_table[(prev << 2) | (symbols[i] << 1) | symbols[i + 1]];
+		prev = symbols[i + 1];
+	}
+	return n;
+}
+
+
+unsigned int table_decoder::encode(const char *bits, unsigned int nbits, int prev, std::vector<unsigned char> &symbols) {
+
+	unsigned int i, j;
+
+	for(i = 0; i < nbits; i++) {
+		for(j = 0; j < 4 && m_table[(prev << 2) | j] != bits[i]; j++)
+			;
+		if(j == 4)
+			break;
+		symbols.push_back(j >> 1);
+		symbols.push_back(j & 1);
+		prev = j & 1;
+	}
+	return i;
+}
+
+
+/*
+ * 5b/6b and 3b/4b codes, first bit sent in the most significant place, as
+ * sent when the running disparity is negative.
+ */
+static const unsigned char code6[32] = {
+	047, 035, 055, 061, 065, 051, 031, 070, 071, 045, 025, 064, 015, 054, 034, 027,
+	033, 043, 023, 062, 013, 052, 032, 072, 063, 046, 026, 066, 016, 056, 036, 053
+};
+static const unsigned char code4[8] = {013, 011, 005, 014, 015, 012, 006, 016};
+static const unsigned char control4[8] = {013, 006, 012, 014, 015, 005, 011, 007};
+
+static int ones(unsigned int v) {
+
+	int n = 0;
+
+	for(; v; v >>= 1)
+		n += v & 1;
+	return n;
+}
+
+
+/*
+ * The 10-bit code for byte given the running disparity rd (-1 or 1), which is
+ * updated.  control asks for a K code; only K.28.y and K.23, 27, 29 and 30.7
+ * exist.
+ */
+unsigned int decoder_8b10b::encode_byte(unsigned int byte, int control, int &rd) {
+
+	unsigned int x = byte & 31, y = byte >> 5, six, four;
+
+	// D.07 and x.3 are balanced but still alternate
+	six = (control && x == 28)? 017 : code6[x];
+	if(rd > 0 && (ones(six) != 3 || x == 7))
+		six ^= 077;
+	if(ones(six) != 3)
+		rd = -rd;
+
+	if(control)
+		four = control4[y];
+	else if(y == 7 && ((rd < 0 && (x == 17 || x == 18 || x == 20)) || (rd > 0 && (x == 11 || x == 13 || x == 14))))
+		four = 007;
+	else
+		four = code4[y];
+	if(rd > 0 && (ones(four) != 2 || y == 3 || control))
+		four ^= 017;
+	if(ones(four) != 2)
+		rd = -rd;
+
+	return (six << 4) | four;
+}
+
+
+decoder_8b10b::decoder_8b10b(const char *name, line_decoder *inner) {
+
+	static const unsigned int controls[] = {0x1c, 0x3c, 0x5c, 0x7c, 0x9c, 0xbc, 0xdc, 0xfc, 0xf7, 0xfb, 0xfd, 0xfe};
+
+	unsigned int i, r;
+	int rd;
+
+	m_name = name;
+	m_inner = inner;
+
+	for(i = 0; i < 1024; i++)
+		m_table[i] = -1;
+	for(r = 0; r < 2; r++) {
+		for(i = 0; i < 256; i++) {
+			rd = r? 1 : -1;
+			m_table[encode_byte(i, 0, rd)] = i;
+		}
+		for(i = 0; i < sizeof(controls) / sizeof(*controls); i++) {
+			rd = r? 1 : -1;
+			m_table[encode_byte(controls[i], 1, rd)] = 0x100 | controls[i];
+		}
+	}
+}
+
+
+const char *decoder_8b10b::name() {
+
+	return m_name;
+}
+
+
+/*
+ * The inner decoder's bits go in bits first, and each code is replaced by
+ * its byte, which is shorter.
+ */
+unsigned int decoder_8b10b::decode(const unsigned char *symbols, unsigned int nsymbols, int prev, char *bits, unsigned int max_bits) {
+
+	unsigned int i, j, n, nin, code;
+	int v;
+
+	nin = m_inner->decode(symbols, nsymbols, prev, bits, max_bits);
+	for(i = 0, n = 0; i + 10 <= nin; i += 10) {
+		for(v = 0, code = 0, j = 0; j < 10; j++) {
+			if(bits[i + j] == 'X')
+				v = -1;
+			code = (code << 1) | (bits[i + j] == '1');
+		}
+		if(!v)
+			v = m_table[code];
+		for(j = 0; j < 8; j++)
+			bits[n++] = (v < 0)? 'X' : (v & (0x80 >> j))? '1' : '0';
+	}
+	return n;
+}
+
+
+/*
+ * Whole bytes of bits only; the running disparity starts negative.
+ */
+unsigned int decoder_8b10b::encode(const char *bits, unsigned int nbits, int prev, std::vector<unsigned char> &symbols) {
+
+	std::vector<char> inner;
+	unsigned int i, j, byte, code;
+	int rd = -1;
+
+	for(i = 0; i + 8 <= nbits; i += 8) {
+		for(byte = 0, j = 0; j < 8; j++)
+			byte = (byte << 1) | (bits[i + j] == '1');
+		code = encode_byte(byte, 0, rd);
+		for(j = 0; j < 10; j++)
+			inner.push_back((code & (0x200 >> j))? '1' : '0');
+	}
+	if(inner.size())
+		m_inner->encode(&inner[0], inner.size(), prev, symbols);
+	return i;
+}
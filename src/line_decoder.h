@@ -0,0 +1,66 @@
+#ifndef INCLUDED_LINE_DECODER_H
+#define INCLUDED_LINE_DECODER_H
+
+/*
+ * line_decoder
+ *
+ * Line codings tried on the symbols after the preamble.  A decoder is given
+ * the level of each whole symbol (0 low, 1 high) as the slicer found them and
+ * the level of the symbol before the first, and writes '0', '1', or 'X' where
+ * the symbols break the coding.  encode() does the reverse for omnipod_gen.
+ *
+ * The codings of two symbols per bit are a table of 8 entries indexed by the
+ * previous symbol and the bit's two symbols; 8b/10b is a 1024-entry table
+ * over the bits of another decoder.  Decoders are found by name:
+ *
+ *	manchester	1 high-low, 0 low-high
+ *	fm0		inverts at every bit boundary, and in the middle of a 0
+ *	differential	inverts in the middle of every bit, and at the start
+ *			of a 1
+ *	8b10b		8b/10b over manchester, the first code right after
+ *			the preamble; a bad code gives 8 X's and a control
+ *			code its byte value
+ */
+
+#include <vector>
+
+class line_decoder {
+public:
+	virtual ~line_decoder();
+
+	virtual const char *name() = 0;
+	virtual unsigned int decode(const unsigned char *symbols, unsigned int nsymbols, int prev, char *bits, unsigned int max_bits) = 0;
+	virtual unsigned int encode(const char *bits, unsigned int nbits, int prev, std::vector<unsigned char> &symbols) = 0;
+
+	static line_decoder *find(const char *name);
+};
+
+class table_decoder : public line_decoder {
+public:
+	table_decoder(const char *name, const char *table);
+
+	const char *name();
+	unsigned int decode(const unsigned char *symbols, unsigned int nsymbols, int prev, char *bits, unsigned int max_bits);
+	unsigned int encode(const char *bits, unsigned int nbits, int prev, std::vector<unsigned char> &symbols);
+
+private:
+	const char *	m_name;
+	char		m_table[8];		// by previous symbol, first, second
+};
+
+class decoder_8b10b : public line_decoder {
+public:
+	decoder_8b10b(const char *name, line_decoder *inner);
+
+	const char *name();
+	unsigned int decode(const unsigned char *symbols, unsigned int nsymbols, int prev, char *bits, unsigned int max_bits);
+	unsigned int encode(const char *bits, unsigned int nbits, int prev, std::vector<unsigned char> &symbols);
+
+	static unsigned int encode_byte(unsigned int byte, int control, int &rd);
+
+private:
+	const char *	m_name;
+	line_decoder *	m_inner;
+	short		m_table[1024];		// byte, 0x100 for control codes, -1 for none
+};
+#endif /* INCLUDED_LINE_DECODER_H */
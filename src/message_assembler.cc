@@ -0,0 +1,205 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+#include "message_assembler.h"
+
+
+static unsigned int field(const char *bits, unsigned int width) {
+
+	unsigned int i, v = 0;
+
+	for(i = 0; i < width; i++)
+		v = (v << 1) | (bits[i] == '1');
+	return v;
+}
+
+
+// messages given up together come out in the order they were last heard from
+static bool heard_before(const assembled_message &a, const assembled_message &b) {
+
+	if(a.last != b.last)
+		return a.last < b.last;
+	return a.sender < b.sender;
+}
+
+
+message_assembler::message_assembler(unsigned int len, unsigned int max_bursts) {
+
+	if(!len || (len & (len - 1)))
+		throw std::runtime_error("error: message_assembler: length must be a power of 2");
+	m_table.resize(len);
+	for(unsigned int i = 0; i < len; i++)
+		m_table[i].used = 0;
+	m_mask = len - 1;
+	m_used = 0;
+	m_max_bursts = max_bursts;
+	m_timeout = 0;
+}
+
+
+/*
+ * timeout is in samples; 0 turns reassembly off.
+ */
+void message_assembler::set_timeout(unsigned long long timeout) {
+
+	m_timeout = timeout;
+}
+
+
+int message_assembler::enabled() {
+
+	return m_timeout != 0;
+}
+
+
+int message_assembler::pending() {
+
+	return m_used != 0;
+}
+
+
+/*
+ * Adds the frame of a burst starting at sample.  Any messages it completes
+ * or forces out are appended to out.  Returns a frame_status.
+ */
+int message_assembler::add(unsigned long long sample, const char *bits, unsigned int nbits, std::vector<assembled_message> &out) {
+
+	unsigned int i, more, seq, sender, skipped, oldest;
+	int slot, status = FRAME_ADDED;
+	conversation *c;
+
+	if(nbits < header_bits)
+		return FRAME_SHORT;
+	more = bits[0] == '1';
+	seq = field(bits + 3, 5);
+	sender = field(bits + 8, 32);
+
+	expire(sample, out);
+
+	if((slot = find(sender)) >= 0) {
+		c = &m_table[slot];
+
+		// more than half way round is taken as behind
+		skipped = (seq - c->next_seq) & 31;
+		if(skipped >= 16)
+			return FRAME_OUT_OF_ORDER;
+		if(skipped) {
+			c->message.missing += skipped;
+			status = FRAME_GAP;
+		}
+	} else {
+		if(m_used == m_table.size()) {
+			for(oldest = 0, i = 1; i < m_table.size(); i++) {
+				if(m_table[i].message.last < m_table[oldest].message.last)
+					oldest = i;
+			}
+			finish(oldest, MESSAGE_EVICTED, out);
+		}
+		for(slot = home(sender); m_table[slot].used; slot = (slot + 1) & m_mask)
+			;
+		c = &m_table[slot];
+		c->used = 1;
+		m_used += 1;
+		c->message.start = sample;
+		c->message.sender = sender;
+		c->message.bursts = 0;
+		c->message.first_seq = seq;
+		c->message.missing = 0;
+		c->message.bits.clear();
+	}
+
+	c->message.bits.append(bits + header_bits, nbits - header_bits);
+	c->message.bursts += 1;
+	c->message.last_seq = seq;
+	c->next_seq = (seq + 1) & 31;
+	c->message.last = sample;
+
+	if(!more)
+		finish(slot, MESSAGE_COMPLETE, out);
+	else if(c->message.bursts >= m_max_bursts)
+		finish(slot, MESSAGE_OVERFLOW, out);
+	return status;
+}
+
+
+/*
+ * Gives up on messages not added to within the timeout of sample.
+ */
+void message_assembler::expire(unsigned long long sample, std::vector<assembled_message> &out) {
+
+	unsigned int i, n = out.size();
+
+	if(!m_timeout || !m_used)
+		return;
+
+	// finish() may move a later entry into slot i, so look again
+	for(i = 0; i < m_table.size(); ) {
+		if(m_table[i].used && sample >= m_table[i].message.last && sample - m_table[i].message.last >= m_timeout)
+			finish(i, MESSAGE_TIMEOUT, out);
+		else
+			i++;
+	}
+	std::sort(out.begin() + n, out.end(), heard_before);
+}
+
+
+/*
+ * Gives up on every message, at the end of the input.
+ */
+void message_assembler::flush(std::vector<assembled_message> &out) {
+
+	unsigned int i, n = out.size();
+
+	for(i = 0; i < m_table.size(); ) {
+		if(m_table[i].used)
+			finish(i, MESSAGE_TIMEOUT, out);
+		else
+			i++;
+	}
+	std::sort(out.begin() + n, out.end(), heard_before);
+}
+
+
+unsigned int message_assembler::home(unsigned int sender) {
+
+	return (sender * 2654435761U) >> 16 & m_mask;
+}
+
+
+int message_assembler::find(unsigned int sender) {
+
+	unsigned int i, slot;
+
+	for(i = 0, slot = home(sender); i < m_table.size() && m_table[slot].used; i++, slot = (slot + 1) & m_mask) {
+		if(m_table[slot].message.sender == sender)
+			return slot;
+	}
+	return -1;
+}
+
+
+/*
+ * Hands out the message in slot and empties it, shifting back any entry
+ * after it that would otherwise no longer be found from its home.
+ */
+void message_assembler::finish(unsigned int slot, int status, std::vector<assembled_message> &out) {
+
+	unsigned int i = slot, j, h;
+
+	m_table[slot].message.status = status;
+	out.push_back(m_table[slot].message);
+
+	for(j = (i + 1) & m_mask; m_table[j].used && j != slot; j = (j + 1) & m_mask) {
+		h = home(m_table[j].message.sender);
+		if(((j - h) & m_mask) >= ((j - i) & m_mask)) {
+			m_table[i] = m_table[j];
+			i = j;
+		}
+	}
+	m_table[i].used = 0;
+	m_table[i].message.bits.clear();
+	m_used -= 1;
+}
@@ -0,0 +1,77 @@
+#ifndef INCLUDED_MESSAGE_ASSEMBLER_H
+#define INCLUDED_MESSAGE_ASSEMBLER_H
+
+/*
+ * message_assembler
+ *
+ * Puts messages sent over several bursts back together as the bursts arrive.
+ * A frame is the bits after the preamble as REP_DECODE reads them: bit 0 set
+ * if more bursts follow, bits 3 - 7 the sequence number and bits 8 - 39 the
+ * first word, taken as the sender.  The rest of each frame is appended to the
+ * sender's message until a frame without bit 0 completes it.
+ *
+ * Senders are held in an open-addressed table of m_len slots; when it is full
+ * the one heard from longest ago is evicted.  A message that has not grown
+ * within the timeout, or reaches m_max_bursts, is given up as incomplete.
+ */
+
+#include <string>
+#include <vector>
+
+typedef enum {
+	MESSAGE_COMPLETE,
+	MESSAGE_TIMEOUT,		// no burst within the timeout, or end of input
+	MESSAGE_EVICTED,		// table full
+	MESSAGE_OVERFLOW		// too many bursts
+} message_status;
+
+typedef enum {
+	FRAME_ADDED,
+	FRAME_GAP,			// sequence numbers skipped before it
+	FRAME_OUT_OF_ORDER,		// sequence number already passed; dropped
+	FRAME_SHORT			// no room for the header; dropped
+} frame_status;
+
+struct assembled_message {
+	unsigned long long	start;		// first sample of the first burst
+	unsigned long long	last;		// and of the latest
+	unsigned int		sender;
+	unsigned int		bursts;
+	unsigned int		first_seq;
+	unsigned int		last_seq;
+	unsigned int		missing;	// bursts skipped by sequence number
+	int			status;		// message_status
+	std::string		bits;		// '0' / '1'
+};
+
+class message_assembler {
+public:
+	message_assembler(unsigned int len = 16, unsigned int max_bursts = 32);
+
+	void set_timeout(unsigned long long timeout);
+	int enabled();
+	int pending();
+	int add(unsigned long long sample, const char *bits, unsigned int nbits, std::vector<assembled_message> &out);
+	void expire(unsigned long long sample, std::vector<assembled_message> &out);
+	void flush(std::vector<assembled_message> &out);
+
+	static const unsigned int header_bits = 40;
+
+private:
+	struct conversation {
+		int			used;
+		unsigned int		next_seq;
+		assembled_message	message;
+	};
+
+	std::vector<conversation> m_table;
+	unsigned int		m_mask;
+	unsigned int		m_used;
+	unsigned int		m_max_bursts;
+	unsigned long long	m_timeout;	// samples, 0 for off
+
+	unsigned int home(unsigned int sender);
+	int find(unsigned int sender);
+	void finish(unsigned int slot, int status, std::vector<assembled_message> &out);
+};
+#endif /* INCLUDED_MESSAGE_ASSEMBLER_H */
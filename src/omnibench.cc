@@ -0,0 +1,850 @@
+/*
+ * omnibench
+ *
+ * Throughput of the demodulator on synthetic bursts from omnipod_gen.  The
+ * whole of work() is timed for each input type and threshold, then slice(),
+ * manchester_decode() and decode_protocol() on their own using the
+ * generator's ideal runs.
+ *
+ * With -w the synthetic capture is written out instead so that it can be fed
+ * to omnidecode or omnidemod.py.
+ *
+ * With -Y every representation is run over a fixed corpus swept across SNR
+ * and transmitter clock offset.  For each run we report the bursts detected,
+ * the data bits decoded correctly and the CPU time per burst.  The output of
+ * each run can be saved as golden output (-o) and later compared against it
+ * (-c), so that one run measures both speed and any change in what is
+ * decoded.  Recorded captures named on the command line are added to the
+ * golden comparison; having no ground truth they only report bursts.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdexcept>
+#include <string>
+
+#include "omnipod_core.h"
+#include "omnipod_gen.h"
+#include "omnipod_profile.h"
+
+
+static const unsigned int BLOCK_LEN = (1 << 20);	// items per call to work()
+static const double SHORT_SCALE = 8192;			// int16 counts per unit amplitude
+
+
+static void usage(const char *prog) {
+
+	fprintf(stderr, "usage: %s [options]\n", prog);
+	fprintf(stderr, "\t-n <bursts>\tnumber of bursts (default 1000)\n");
+	fprintf(stderr, "\t-i <n>\t\ttimes to run each stage (default 3)\n");
+	fprintf(stderr, "\t-F <hz>\t\tclock speed (default 64e6)\n");
+	fprintf(stderr, "\t-d <n>\t\tdecimation (default 256)\n");
+	fprintf(stderr, "\t-r <rep>\trepresentation for work() (defaults to 'Decode')\n");
+	fprintf(stderr, "\t-N <db>\t\tSNR (default 30)\n");
+	fprintf(stderr, "\t-a <amplitude>\tcarrier amplitude (default 1)\n");
+	fprintf(stderr, "\t-J <symbols>\ttransition jitter (default 0)\n");
+	fprintf(stderr, "\t-P <ppm>\ttransmitter clock offset (default 0)\n");
+	fprintf(stderr, "\t-g <ms>\t\tminimum idle gap (default 5)\n");
+	fprintf(stderr, "\t-G <ms>\t\tmaximum idle gap (default 50)\n");
+	fprintf(stderr, "\t-b <bits>\tdata bits per burst (default 168)\n");
+	fprintf(stderr, "\t-e <seed>\trandom seed (default 1)\n");
+	fprintf(stderr, "\t-k <coding>\tline coding of the data: 'manchester', 'fm0', 'differential', '8b10b' (default 'manchester')\n");
+	fprintf(stderr, "\t-w <filename>\twrite the synthetic capture and exit\n");
+	fprintf(stderr, "\t-S\t\twrite interleaved int16 rather than complex float\n");
+	fprintf(stderr, "\t-Y\t\tmeasure decode yield of every representation\n");
+	fprintf(stderr, "\t-L <db,...>\tSNR sweep for -Y (default 30,20,15,12,10,8,6)\n");
+	fprintf(stderr, "\t-C <ppm,...>\tclock offset sweep for -Y (default 0,-5000,5000)\n");
+	fprintf(stderr, "\t-t <threshold>\tthreshold for -Y: 'average', 'tracker', 'matched' (default 'average')\n");
+	fprintf(stderr, "\t-o <dir>\twrite the output of each -Y run to dir as golden output\n");
+	fprintf(stderr, "\t-c <dir>\tcompare the output of each -Y run with the golden output in dir\n");
+	fprintf(stderr, "\n\tWith -Y, files named after the options are recorded captures added to the\n");
+	fprintf(stderr, "\tgolden comparison.\n");
+	exit(1);
+}
+
+
+static double elapsed(const struct timeval &start) {
+
+	struct timeval now;
+
+	gettimeofday(&now, 0);
+	return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+}
+
+
+static double cpu_time() {
+
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+
+static void report(const char *stage, double t, unsigned long long nitems, unsigned long long nbursts) {
+
+	if(t <= 0)
+		t = 1e-9;
+	printf("%-24s %8.3fs %10.2f Msamples/s %12.1f bursts/s\n", stage, t, nitems / t / 1e6, nbursts / t);
+}
+
+
+/*
+ * Reaches into omnipod_core to time its stages on their own.
+ */
+class omnipod_bench {
+public:
+	omnipod_bench(double clock_speed, unsigned int decimation, unsigned int iterations);
+
+	void work(const char *stage, const void *buf, unsigned long long nitems, int short_input, int threshold, int rep);
+	void stages(const std::vector<omnipod_truth> &truth);
+
+private:
+	double		m_clock_speed;
+	unsigned int	m_decimation;
+	unsigned int	m_iterations;
+
+	omnipod_core *make_core(int short_input, int rep);
+};
+
+
+omnipod_bench::omnipod_bench(double clock_speed, unsigned int decimation, unsigned int iterations) {
+
+	m_clock_speed = clock_speed;
+	m_decimation = decimation;
+	m_iterations = iterations;
+}
+
+
+/*
+ * Output is formatted and written, but to /dev/null.
+ */
+omnipod_core *omnipod_bench::make_core(int short_input, int rep) {
+
+	omnipod_core *core;
+
+	core = new omnipod_core(m_clock_speed, m_decimation, short_input);
+	core->set_representation(rep);
+	core->set_output((char *)"/dev/null");
+	core->set_quiet();
+	core->show_samples();
+	core->show_power();
+
+	return core;
+}
+
+
+void omnipod_bench::work(const char *stage, const void *buf, unsigned long long nitems, int short_input, int threshold, int rep) {
+
+	unsigned int i, n, used;
+	unsigned long long pos, bursts = 0;
+	double t = 0;
+	struct timeval start;
+	omnipod_core *core;
+
+
+	omnipod_profile_reset();
+	for(i = 0; i < m_iterations; i++) {
+		core = make_core(short_input, rep);
+		core->set_threshold(threshold);
+
+		gettimeofday(&start, 0);
+		for(pos = 0; pos < nitems; pos += used) {
+			n = (nitems - pos > BLOCK_LEN)? BLOCK_LEN : (unsigned int)(nitems - pos);
+			if(!(used = core->work((const char *)buf + pos * core->item_size(), n)))
+				break;
+		}
+		t += elapsed(start);
+
+		bursts += core->burst_count();
+		delete core;
+	}
+
+	report(stage, t, nitems * m_iterations, bursts);
+
+	// the stage timers, if built in, for this configuration alone
+	if(omnipod_profile_enabled())
+		omnipod_profile_dump(stdout);
+}
+
+
+void omnipod_bench::stages(const std::vector<omnipod_truth> &truth) {
+
+	unsigned int i, j, k;
+	unsigned long long nitems = 0, nbursts;
+	double t, sps, x;
+	volatile float sum = 0;
+	struct timeval start;
+	std::vector<std::vector<unsigned char> > symbols;
+	std::vector<unsigned char> dbuf;
+	std::vector<char> data;
+	omnipod_core *core;
+
+
+	for(k = 0; k < truth.size(); k++)
+		nitems += truth[k].end - truth[k].start;
+	nbursts = truth.size() * m_iterations;
+	nitems *= m_iterations;
+
+	// slice() on the ideal runs, keeping what it demodulates
+	core = make_core(0, REP_DECODE);
+	t = 0;
+	for(i = 0; i < m_iterations; i++) {
+		symbols.clear();
+		gettimeofday(&start, 0);
+		for(k = 0; k < truth.size(); k++) {
+			for(j = 0; j < truth[k].runs.size(); j++) {
+				core->m_sign = truth[k].runs[j].level? 1 : -1;
+				core->m_count = truth[k].runs[j].width;
+				core->slice();
+			}
+			symbols.push_back(std::vector<unsigned char>(core->m_dbuf.begin(), core->m_dbuf.begin() + core->m_dbuf_count));
+			core->m_dbuf_count = 0;
+			core->m_signal_len = 0;
+		}
+		t += elapsed(start);
+	}
+	report("slice", t, nitems, nbursts);
+
+	// manchester_decode() alters its input, so it gets a copy each time
+	t = 0;
+	for(i = 0; i < m_iterations; i++) {
+		for(k = 0; k < symbols.size(); k++) {
+			if(!symbols[k].size())
+				continue;
+			dbuf = symbols[k];
+			data.resize(2 * dbuf.size());
+			gettimeofday(&start, 0);
+			omnipod_core::manchester_decode(&dbuf[0], dbuf.size(), &data[0], data.size());
+			t += elapsed(start);
+		}
+	}
+	report("manchester_decode", t, nitems, nbursts);
+
+	t = 0;
+	for(i = 0; i < m_iterations; i++) {
+		for(k = 0; k < symbols.size(); k++) {
+			if(!symbols[k].size())
+				continue;
+			core->fit_burst(symbols[k].size());
+			memcpy(&core->m_dbuf[0], &symbols[k][0], symbols[k].size());
+			core->m_dbuf_count = symbols[k].size();
+			core->m_data_len = -1;
+			gettimeofday(&start, 0);
+			core->decode_protocol();
+			t += elapsed(start);
+		}
+	}
+	core->m_dbuf_count = 0;
+	report("decode_protocol", t, nitems, nbursts);
+
+	// decode_soft()'s integrate-and-dump over every symbol of the ideal envelope
+	sps = core->m_sps_q16 / 65536.0;
+	t = 0;
+	for(k = 0; k < truth.size(); k++) {
+		core->m_soft.clear();
+		for(j = 0; j < truth[k].runs.size(); j++)
+			core->m_soft.insert(core->m_soft.end(), truth[k].runs[j].width, truth[k].runs[j].level? 1.0f : 0.0f);
+		gettimeofday(&start, 0);
+		for(i = 0; i < m_iterations; i++)
+			for(x = 0; x + sps <= core->m_soft.size(); x += sps)
+				sum += core->window(x + sps / 8, x + sps - sps / 8);
+		t += elapsed(start);
+	}
+	report("window", t, nitems, nbursts);
+
+	delete core;
+}
+
+
+static const char *rep_name[] = {"compressed", "nrz", "strict", "manchester", "decode", "soft", "fm0", "differential", "8b10b"};
+static const unsigned int nreps = sizeof(rep_name) / sizeof(*rep_name);
+
+// what each representation is measured on
+static const char *rep_coding[] = {"manchester", "manchester", "manchester", "manchester", "manchester", "manchester",
+   "fm0", "differential", "8b10b"};
+
+
+struct yield_result {
+	unsigned int		detected;	// bursts with output
+	unsigned int		bits;		// data bits decoded correctly
+	double			cpu;		// seconds
+	std::string		output;		// for the golden comparison
+};
+
+
+/*
+ * A recorded burst's text without the screen-only diagnostics.
+ */
+static std::string burst_text(const omnipod_burst &b) {
+
+	unsigned int i;
+	std::string text;
+
+	for(i = 0; i < b.pieces.size(); i++)
+		if(b.pieces[i].type == PIECE_TEXT && !b.pieces[i].sink)
+			text += b.pieces[i].text;
+	return text;
+}
+
+
+/*
+ * Data bits following the preamble in a symbol-level representation.  The
+ * preamble ends 1111 0 and the "^" violation; after it, pairs of symbols
+ * are Manchester bits.
+ */
+static std::string symbol_bits(const std::string &text, char high, char low) {
+
+	static const char *tail = "1010101001";
+
+	std::string::size_type p, n;
+	std::string sym, bits;
+	unsigned int i;
+
+	for(p = 0; (p = text.find('^', p)) != std::string::npos; p++) {
+		sym.clear();
+		for(n = p; n > 0 && sym.size() < strlen(tail); n--) {
+			if(text[n - 1] == high)
+				sym.insert(sym.begin(), '1');
+			else if(text[n - 1] == low)
+				sym.insert(sym.begin(), '0');
+			else if(text[n - 1] != ' ')
+				break;
+		}
+		if(sym == tail)
+			break;
+	}
+	if(p == std::string::npos)
+		return bits;
+	sym.clear();
+	for(p += 1; p < text.size(); p++) {
+		if(text[p] == high)
+			sym += '1';
+		else if(text[p] == low)
+			sym += '0';
+		else if(text[p] != ' ')
+			break;
+	}
+	for(i = 0; i + 1 < sym.size(); i += 2) {
+		if(sym[i] == sym[i + 1])
+			break;
+		bits += sym[i];
+	}
+	return bits;
+}
+
+
+/*
+ * decode_protocol() fields back into bits; fields shown as X are unknown.
+ */
+static std::string protocol_bits(const std::string &text) {
+
+	static const unsigned int widths[] = {1, 2, 5, 32, 32, 32, 32, 16, 4, 4, 4, 4};
+
+	std::string::size_type p;
+	std::string bits;
+	unsigned int f, j, n;
+	unsigned long v;
+	char field[64];
+
+	if((p = text.find("P:")) == std::string::npos)
+		return bits;
+	p += 2;
+	for(f = 0; f < sizeof(widths) / sizeof(*widths); f++) {
+		if(sscanf(text.c_str() + p, " %63s%n", field, &n) != 1 || field[0] == '!')
+			break;
+		p += n;
+		if(strchr(field, 'X')) {
+			bits.append(widths[f], '?');
+			continue;
+		}
+		v = strtoul(field, 0, 16);
+		for(j = widths[f]; j > 0; j--)
+			bits += ((v >> (j - 1)) & 1)? '1' : '0';
+	}
+	return bits;
+}
+
+
+static std::string decoded_bits(int rep, const std::string &text) {
+
+	static const char *preamble = "1101111110^";
+
+	std::string::size_type p;
+	std::string s, bits;
+	unsigned int i;
+
+	switch(rep) {
+		case REP_COMPRESSED:
+			return symbol_bits(text, '-', '_');
+
+		case REP_NRZ:
+			return symbol_bits(text, '1', '0');
+
+		case REP_MANCHESTER_STRICT:
+		case REP_FM0:
+		case REP_DIFF_MANCHESTER:
+		case REP_8B10B:
+			// the bits are the last line
+			p = text.rfind('\n', text.size() - 2);
+			s = text.substr((p == std::string::npos)? 0 : p + 1);
+			for(i = 0; i < s.size() && (s[i] == '0' || s[i] == '1'); i++)
+				bits += s[i];
+			return bits;
+
+		case REP_MANCHESTER:
+			for(i = 0; i < text.size(); i++)
+				if(text[i] != ' ')
+					s += text[i];
+			if((p = s.find(preamble)) == std::string::npos)
+				return bits;
+			for(p += strlen(preamble); p < s.size() && (s[p] == '0' || s[p] == '1'); p++)
+				bits += s[p];
+			return bits;
+
+		case REP_DECODE:
+			return protocol_bits(text);
+
+		case REP_SOFT:
+			// the bits, then a line of their confidences
+			p = text.rfind('\n', text.size() - 2);
+			if(p == std::string::npos)
+				return bits;
+			s = text.substr(0, p);
+			p = s.rfind('\n');
+			s = s.substr((p == std::string::npos)? 0 : p + 1);
+			for(i = 0; i < s.size() && (s[i] == '0' || s[i] == '1'); i++)
+				bits += s[i];
+			return bits;
+	}
+	return bits;
+}
+
+
+static unsigned int bits_correct(const std::string &decoded, const std::string &truth) {
+
+	unsigned int i, n = 0;
+
+	for(i = 0; i < decoded.size() && i < truth.size(); i++)
+		if(decoded[i] == truth[i])
+			n += 1;
+	return n;
+}
+
+
+/*
+ * Run one representation over a signal, recording its output.
+ */
+static void yield_run(double clock_speed, unsigned int decimation, int threshold, int rep, const void *buf, unsigned long long nitems, int short_input, std::vector<omnipod_burst> &bursts, double &cpu) {
+
+	unsigned int n, used;
+	unsigned long long pos;
+	double t;
+	omnipod_core core(clock_speed, decimation, short_input);
+
+	core.set_representation(rep);
+	core.set_threshold(threshold);
+	core.record_bursts(0);
+	t = cpu_time();
+	for(pos = 0; pos < nitems; pos += used) {
+		n = (nitems - pos > BLOCK_LEN)? BLOCK_LEN : (unsigned int)(nitems - pos);
+		if(!(used = core.work((const char *)buf + pos * core.item_size(), n)))
+			break;
+	}
+	cpu = cpu_time() - t;
+	core.take_bursts(bursts);
+}
+
+
+static void yield_score(int rep, const std::vector<omnipod_burst> &bursts, const std::vector<omnipod_truth> &truth, unsigned int slop, yield_result &r) {
+
+	unsigned int i, k, best, b;
+	long long start;
+	char line[64];
+	std::string text, bits;
+
+	r.detected = 0;
+	r.bits = 0;
+	r.output.clear();
+
+	for(i = 0; i < bursts.size(); i++) {
+		text = burst_text(bursts[i]);
+		if(!text.size())
+			continue;
+		snprintf(line, sizeof(line), "%llu\t", bursts[i].start);
+		r.output += line + text;
+	}
+
+	// bursts and truth are both in sample order
+	for(k = 0, i = 0; k < truth.size(); k++) {
+		best = 0;
+		b = 0;
+		for(; i < bursts.size(); i++) {
+			start = (long long)bursts[i].start;
+			if(start + slop < (long long)truth[k].start)
+				continue;
+			if(start >= (long long)truth[k].end)
+				break;
+			// detected once the preamble is found
+			bits = decoded_bits(rep, burst_text(bursts[i]));
+			if(!bits.size())
+				continue;
+			b = 1;
+			if((start = bits_correct(bits, truth[k].bits)) > best)
+				best = start;
+		}
+		r.detected += b;
+		r.bits += best;
+	}
+}
+
+
+/*
+ * Returns 1 if the same as the golden output, 0 if not and -1 if there is
+ * none.  Writes the golden output instead when save is set.
+ */
+static int golden(const char *dir, const std::string &name, const std::string &output, int save) {
+
+	std::string path = std::string(dir) + "/" + name + ".golden", old;
+	FILE *fp;
+	char buf[BUFSIZ];
+	size_t n;
+
+	if(save) {
+		if(!(fp = fopen(path.c_str(), "w"))) {
+			perror(path.c_str());
+			throw std::runtime_error("error: cannot write golden output");
+		}
+		fwrite(output.data(), 1, output.size(), fp);
+		fclose(fp);
+		return 1;
+	}
+
+	if(!(fp = fopen(path.c_str(), "r")))
+		return -1;
+	while((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		old.append(buf, n);
+	fclose(fp);
+	return old == output;
+}
+
+
+static std::vector<double> parse_list(const char *s) {
+
+	std::vector<double> v;
+	char *end;
+
+	for(;;) {
+		v.push_back(strtod(s, &end));
+		if(end == s || *end != ',')
+			break;
+		s = end + 1;
+	}
+	return v;
+}
+
+
+/*
+ * Returns the number of golden mismatches.
+ */
+static int yield(const omnipod_gen &proto, double clock_speed, unsigned int decimation, int threshold, unsigned int nbursts,
+   const std::vector<double> &snrs, const std::vector<double> &ppms, const char *dir, int save, char **files, int nfiles) {
+
+	unsigned int i, j, k, n, total = 0, mismatches = 0;
+	int g;
+	double cpu, sps = clock_speed / decimation / 4000;
+	char name[BUFSIZ];
+	const char *gs;
+	std::vector<omnipod_complex> signal;
+	std::vector<omnipod_truth> truth;
+	std::vector<omnipod_burst> bursts;
+	yield_result r;
+
+
+	printf("%-12s %6s %7s %7s %9s %8s %14s %8s\n", "rep", "snr", "ppm", "bursts", "detected", "bits %", "cpu us/burst", "golden");
+	for(i = 0; i < snrs.size(); i++) {
+		for(j = 0; j < ppms.size(); j++) {
+			for(k = 0; k < nreps; k++) {
+				// the same bursts again in the representation's coding
+				if(!k || strcmp(rep_coding[k], rep_coding[k - 1])) {
+					omnipod_gen gen(proto);
+					gen.set_snr(snrs[i]);
+					gen.set_clock_offset(ppms[j]);
+					gen.set_coding(line_decoder::find(rep_coding[k]));
+					signal.clear();
+					truth.clear();
+					gen.generate(signal, nbursts, &truth);
+
+					// a burst only ends at the next transition; this one is not scored
+					gen.burst(signal);
+					gen.idle(signal, (unsigned int)(50e-3 * clock_speed / decimation));
+					for(total = 0, n = 0; n < truth.size(); n++)
+						total += truth[n].bits.size();
+				}
+
+				yield_run(clock_speed, decimation, threshold, k, &signal[0], signal.size(), 0, bursts, cpu);
+				// the reported start leads the burst by up to the averaging delay
+				yield_score(k, bursts, truth, (unsigned int)(20 * sps), r);
+
+				gs = "-";
+				if(dir) {
+					snprintf(name, sizeof(name), "%s-snr%g-ppm%g", rep_name[k], snrs[i], ppms[j]);
+					g = golden(dir, name, r.output, save);
+					gs = save? "saved" : (g < 0)? "none" : g? "ok" : "DIFF";
+					if(!save && !g)
+						mismatches += 1;
+				}
+				printf("%-12s %6.1f %7.0f %7u %9u %7.2f%% %14.1f %8s\n", rep_name[k], snrs[i], ppms[j], nbursts, r.detected,
+				   total? 100.0 * r.bits / total : 0, nbursts? 1e6 * cpu / nbursts : 0, gs);
+			}
+		}
+	}
+
+	// recorded captures: no truth, just bursts and the golden comparison
+	for(i = 0; i < (unsigned int)nfiles; i++) {
+		FILE *fp;
+		struct stat st;
+		std::vector<omnipod_complex> rec;
+		const char *p;
+
+		if(stat(files[i], &st) == -1 || !(fp = fopen(files[i], "r"))) {
+			perror(files[i]);
+			mismatches += 1;
+			continue;
+		}
+		rec.resize(st.st_size / sizeof(omnipod_complex));
+		if(rec.size() && fread(&rec[0], sizeof(omnipod_complex), rec.size(), fp) != rec.size())
+			rec.clear();
+		fclose(fp);
+
+		p = strrchr(files[i], '/');
+		p = p? p + 1 : files[i];
+		for(k = 0; k < nreps; k++) {
+			yield_run(clock_speed, decimation, threshold, k, rec.size()? &rec[0] : 0, rec.size(), 0, bursts, cpu);
+			yield_score(k, bursts, std::vector<omnipod_truth>(), 0, r);
+			for(r.detected = 0, j = 0; j < bursts.size(); j++)
+				if(burst_text(bursts[j]).size())
+					r.detected += 1;
+
+			gs = "-";
+			if(dir) {
+				snprintf(name, sizeof(name), "%s-%s", rep_name[k], p);
+				g = golden(dir, name, r.output, save);
+				gs = save? "saved" : (g < 0)? "none" : g? "ok" : "DIFF";
+				if(!save && !g)
+					mismatches += 1;
+			}
+			printf("%-12s %6s %7s %7s %9u %8s %14.1f %8s  %s\n", rep_name[k], "-", "-", "-", r.detected, "-",
+			   r.detected? 1e6 * cpu / r.detected : 0, gs, p);
+		}
+	}
+
+	return mismatches;
+}
+
+
+static int parse_threshold(const char *s) {
+
+	switch(s[0]) {
+		case 'a':
+		case 'A':
+			return THRESHOLD_AVERAGE;
+		case 't':
+		case 'T':
+			return THRESHOLD_TRACKER;
+		case 'm':
+		case 'M':
+			return THRESHOLD_MATCHED;
+	}
+	return -1;
+}
+
+
+static int parse_rep(const char *s) {
+
+	switch(s[0]) {
+		case 'c':
+		case 'C':
+			return REP_COMPRESSED;
+		case 'n':
+		case 'N':
+			return REP_NRZ;
+		case 's':
+		case 'S':
+			if(s[1] == 'o' || s[1] == 'O')
+				return REP_SOFT;
+			return REP_MANCHESTER_STRICT;
+		case 'm':
+		case 'M':
+			return REP_MANCHESTER;
+		case 'd':
+		case 'D':
+			if(s[1] == 'i' || s[1] == 'I')
+				return REP_DIFF_MANCHESTER;
+			return REP_DECODE;
+		case 'f':
+		case 'F':
+			return REP_FM0;
+		case '8':
+			return REP_8B10B;
+	}
+	return -1;
+}
+
+
+int main(int argc, char **argv) {
+
+	int c, rep = REP_DECODE, write_short = 0;
+	unsigned int nbursts = 1000, iterations = 3, decimation = 256, nbits = 168, seed = 1;
+	double clock_speed = 64e6, snr = 30, amplitude = 1, jitter = 0, ppm = 0, gap_min = 5, gap_max = 50;
+	char *outfile = 0, *golden_dir = 0;
+	line_decoder *coding = line_decoder::find("manchester");
+	int yield_mode = 0, save_golden = 0, threshold = THRESHOLD_AVERAGE;
+	std::vector<double> snrs = parse_list("30,20,15,12,10,8,6"), ppms = parse_list("0,-5000,5000");
+	FILE *fp;
+	std::vector<omnipod_complex> signal;
+	std::vector<short> ssignal;
+	std::vector<omnipod_truth> truth;
+
+
+	while((c = getopt(argc, argv, "n:i:F:d:r:N:a:J:P:g:G:b:e:k:w:SYL:C:t:o:c:h?")) != EOF) {
+		switch(c) {
+			case 'n':
+				nbursts = strtoul(optarg, 0, 0);
+				break;
+			case 'i':
+				iterations = strtoul(optarg, 0, 0);
+				break;
+			case 'F':
+				clock_speed = strtod(optarg, 0);
+				break;
+			case 'd':
+				decimation = strtoul(optarg, 0, 0);
+				break;
+			case 'r':
+				if((rep = parse_rep(optarg)) < 0) {
+					fprintf(stderr, "error: unknown representation\n");
+					return -1;
+				}
+				break;
+			case 'N':
+				snr = strtod(optarg, 0);
+				break;
+			case 'a':
+				amplitude = strtod(optarg, 0);
+				break;
+			case 'J':
+				jitter = strtod(optarg, 0);
+				break;
+			case 'P':
+				ppm = strtod(optarg, 0);
+				break;
+			case 'g':
+				gap_min = strtod(optarg, 0);
+				break;
+			case 'G':
+				gap_max = strtod(optarg, 0);
+				break;
+			case 'b':
+				nbits = strtoul(optarg, 0, 0);
+				break;
+			case 'e':
+				seed = strtoul(optarg, 0, 0);
+				break;
+			case 'k':
+				if(!(coding = line_decoder::find(optarg))) {
+					fprintf(stderr, "error: unknown coding\n");
+					return -1;
+				}
+				break;
+			case 'w':
+				outfile = optarg;
+				break;
+			case 'S':
+				write_short = 1;
+				break;
+			case 'Y':
+				yield_mode = 1;
+				break;
+			case 'L':
+				snrs = parse_list(optarg);
+				break;
+			case 'C':
+				ppms = parse_list(optarg);
+				break;
+			case 't':
+				if((threshold = parse_threshold(optarg)) < 0) {
+					fprintf(stderr, "error: unknown threshold\n");
+					return -1;
+				}
+				break;
+			case 'o':
+				golden_dir = optarg;
+				save_golden = 1;
+				break;
+			case 'c':
+				golden_dir = optarg;
+				save_golden = 0;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if((optind != argc && !yield_mode) || !decimation || clock_speed <= 0 || !iterations)
+		usage(argv[0]);
+
+	try {
+		omnipod_gen gen(clock_speed / decimation, seed);
+		gen.set_amplitude(amplitude);
+		gen.set_snr(snr);
+		gen.set_jitter(jitter);
+		gen.set_clock_offset(ppm);
+		gen.set_gap(gap_min, gap_max);
+		gen.set_bits(nbits);
+		gen.set_coding(coding);
+
+		if(yield_mode)
+			return yield(gen, clock_speed, decimation, threshold, nbursts, snrs, ppms, golden_dir, save_golden, argv + optind, argc - optind)? 1 : 0;
+
+		gen.generate(signal, nbursts, &truth);
+		omnipod_gen::to_short(signal, ssignal, SHORT_SCALE);
+
+		if(outfile) {
+			if(!(fp = fopen(outfile, "w"))) {
+				perror(outfile);
+				return -1;
+			}
+			if(write_short)
+				fwrite(&ssignal[0], 2 * sizeof(short), signal.size(), fp);
+			else
+				fwrite(&signal[0], sizeof(omnipod_complex), signal.size(), fp);
+			fclose(fp);
+			return 0;
+		}
+
+		printf("%u bursts, %lu samples at %.0f samples/s, SNR %.1fdB\n", nbursts, (unsigned long)signal.size(), clock_speed / decimation, snr);
+
+		omnipod_bench bench(clock_speed, decimation, iterations);
+		bench.work("work (float)", &signal[0], signal.size(), 0, THRESHOLD_AVERAGE, rep);
+		bench.work("work (int16)", &ssignal[0], signal.size(), 1, THRESHOLD_AVERAGE, rep);
+		bench.work("work (float, tracker)", &signal[0], signal.size(), 0, THRESHOLD_TRACKER, rep);
+		bench.work("work (int16, tracker)", &ssignal[0], signal.size(), 1, THRESHOLD_TRACKER, rep);
+		bench.work("work (float, matched)", &signal[0], signal.size(), 0, THRESHOLD_MATCHED, rep);
+		bench.work("work (int16, matched)", &ssignal[0], signal.size(), 1, THRESHOLD_MATCHED, rep);
+		bench.stages(truth);
+	} catch(std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,902 @@
+/*
+ * omnidecode
+ *
+ * Decode a recorded capture without GNU Radio.  The file is mapped into
+ * memory and handed to omnipod_core in large blocks.  Options and output
+ * match omnidemod.py.
+ *
+ * With -j the file is cut into chunks that are decoded on a pool of threads.
+ * Each chunk is decoded from omnipod_core::overlap() items before its start
+ * so that the demodulator is in the same state as a sequential run when it
+ * reaches the chunk, and past its end until the last burst starting in the
+ * chunk is finished.  A burst belongs to the chunk its first sample is in;
+ * copies seen by the neighbouring chunks are dropped.  As long as no burst
+ * is longer than the overlap the output is the same as a sequential run.
+ *
+ * Given files or directories instead of -f, every file is decoded on its own
+ * thread (-j sets how many).  Each thread starts with a share of the files,
+ * biggest first, and steals from the others when it runs out.  Bursts go to
+ * the screen and -o, grouped by file, or with -O to one file per capture.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <algorithm>
+#include <deque>
+
+#include "omnipod_core.h"
+#include "omnipod_profile.h"
+
+
+static const unsigned int BLOCK_LEN = (1 << 20);	// items per call to work()
+static const unsigned int CHUNK_LEN = (1 << 24);	// items per parallel chunk
+
+
+struct options {
+	double		clock_speed;
+	unsigned int	decimation;
+	int		short_input;
+	int		rep;
+	int		threshold;
+	int		hex;
+	int		power;
+	int		samples;
+	char *		outfile;
+	char *		capfile;
+	char *		check;			// frame checks
+	char *		invalid;		// frames that fail them
+	double		dedup;			// repeat window, seconds
+	double		messages;		// reassembly timeout, seconds
+	double		burst_timeout;		// symbols
+	double		max_burst;		// seconds
+	std::vector<int> also_rep;		// representations also run
+	std::vector<std::string> also_file;	// and their files
+};
+
+
+struct chunk {
+	unsigned long long		begin;		// first item owned
+	unsigned long long		end;		// one past last item owned
+	std::vector<omnipod_burst>	bursts;
+	int				done;
+	std::string			error;
+};
+
+
+struct batch_file {
+	std::string		name;
+	unsigned long long	size;
+};
+
+
+struct batch_queue {
+	std::deque<batch_file>	files;			// biggest first
+	pthread_mutex_t		mutex;
+};
+
+
+struct batch {
+	const options *		opt;
+	const char *		outdir;			// per-file output, or 0 to merge
+	std::vector<batch_queue *> queues;		// one per thread
+	unsigned int		nfiles;
+	unsigned int		done;
+	unsigned int		errors;
+	unsigned long long	items;
+	unsigned long long	bytes;
+	unsigned long long	bursts;
+	struct timeval		start;
+	pthread_mutex_t		mutex;			// output and the totals above
+};
+
+
+struct pool {
+	const options *		opt;
+	const char *		base;
+	unsigned long long	nitems;
+	std::vector<chunk>	chunks;
+	unsigned int		next;			// next chunk to decode
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;			// a chunk finished
+};
+
+
+static void usage(const char *prog) {
+
+	fprintf(stderr, "usage: %s [options] -f <filename>\n", prog);
+	fprintf(stderr, "       %s [options] [-L <list>] [-O <dir>] <file or directory> ...\n", prog);
+	fprintf(stderr, "\t-f <filename>\tinput capture\n");
+	fprintf(stderr, "\t-L <list>\tdecode the captures named in list, one per line\n");
+	fprintf(stderr, "\t-O <dir>\twrite each capture's output to dir/<name>.txt\n");
+	fprintf(stderr, "\t-F <hz>\t\tclock speed of the capture (default 64e6)\n");
+	fprintf(stderr, "\t-d <n>\t\tdecimation of the capture (default 256)\n");
+	fprintf(stderr, "\t-S\t\tinput is interleaved int16 rather than complex float\n");
+	fprintf(stderr, "\t-o <filename>\tset output to file (defaults to screen)\n");
+	fprintf(stderr, "\t-r <rep>\tset representation: 'compressed', 'NRZ', 'Manchester', 'StrictManchester', 'Decode', 'Soft', 'FM0', 'Differential', '8b10b' (defaults to 'Manchester')\n");
+	fprintf(stderr, "\t-t <threshold>\tset threshold: 'average', 'tracker', 'matched' (defaults to 'average')\n");
+	fprintf(stderr, "\t-H\t\tinclude hex representation of data\n");
+	fprintf(stderr, "\t-p\t\tshow average power of each burst\n");
+	fprintf(stderr, "\t-s\t\tshow starting sample of captured burst\n");
+	fprintf(stderr, "\t-c <filename>\tsave captured signal bursts in ``filename-clock_speed-decimation.omnidump''\n");
+	fprintf(stderr, "\t-V <checks>\tframe checks, e.g. crc16:1021:ffff:0:0:0:64,markers:0 (see frame_check.h)\n");
+	fprintf(stderr, "\t-i <filename>\twrite frames that fail the checks to file rather than dropping them\n");
+	fprintf(stderr, "\t-D <seconds>\tcount bursts repeated within seconds rather than decoding them again\n");
+	fprintf(stderr, "\t-M <seconds>\treassemble messages over several bursts, giving up after seconds\n");
+	fprintf(stderr, "\t-E <symbols>\tend a burst once no transition has come for this many symbols\n");
+	fprintf(stderr, "\t-m <seconds>\tdecode bursts up to this long whole (default 1)\n");
+	fprintf(stderr, "\t-A <rep>:<file>\talso write representation rep to file; may be repeated\n");
+	fprintf(stderr, "\t-j <n>\t\tdecode with n threads, 0 for one per processor (default 1)\n");
+	fprintf(stderr, "\t-P\t\tprint the stage timers on exit (configure --enable-profile-timers)\n");
+	fprintf(stderr, "\n\tThe clock speed and decimation of *-<MHz>MHz-<decimation>.omnidump\n");
+	fprintf(stderr, "\tfiles are taken from their names.\n");
+	exit(1);
+}
+
+
+/*
+ * Same letters as omnidemod.py.
+ */
+static int parse_rep(const char *s) {
+
+	switch(s[0]) {
+		case 'c':
+		case 'C':
+			return REP_COMPRESSED;
+		case 'n':
+		case 'N':
+			return REP_NRZ;
+		case 's':
+		case 'S':
+			if(s[1] == 'o' || s[1] == 'O')
+				return REP_SOFT;
+			return REP_MANCHESTER_STRICT;
+		case 'm':
+		case 'M':
+			return REP_MANCHESTER;
+		case 'd':
+		case 'D':
+			if(s[1] == 'i' || s[1] == 'I')
+				return REP_DIFF_MANCHESTER;
+			return REP_DECODE;
+		case 'f':
+		case 'F':
+			return REP_FM0;
+		case '8':
+			return REP_8B10B;
+	}
+	return -1;
+}
+
+
+static int parse_threshold(const char *s) {
+
+	switch(s[0]) {
+		case 'a':
+		case 'A':
+			return THRESHOLD_AVERAGE;
+		case 't':
+		case 'T':
+			return THRESHOLD_TRACKER;
+		case 'm':
+		case 'M':
+			return THRESHOLD_MATCHED;
+	}
+	return -1;
+}
+
+
+/*
+ * The output files are only opened for the instance that writes.
+ */
+static omnipod_core *make_core(const options &opt, int writer) {
+
+	omnipod_core *core;
+	unsigned int i;
+
+	core = new omnipod_core(opt.clock_speed, opt.decimation, opt.short_input);
+	core->set_representation(opt.rep);
+	core->set_threshold(opt.threshold);
+	if(opt.hex)
+		core->show_hex();
+	if(opt.power)
+		core->show_power();
+	if(opt.samples)
+		core->show_samples();
+	if(opt.check)
+		core->set_frame_check(opt.check);
+	if(opt.dedup > 0)
+		core->set_repeat_window(opt.dedup);
+	if(opt.messages > 0)
+		core->set_reassembly(opt.messages);
+	if(opt.burst_timeout > 0)
+		core->set_burst_timeout(opt.burst_timeout);
+	if(opt.max_burst > 0)
+		core->set_max_burst(opt.max_burst);
+	for(i = 0; i < opt.also_rep.size(); i++)
+		core->add_representation(opt.also_rep[i], writer? (char *)opt.also_file[i].c_str() : 0);
+	if(writer) {
+		if(opt.outfile)
+			core->set_output(opt.outfile);
+		if(opt.capfile)
+			core->set_capture(opt.capfile);
+		if(opt.invalid)
+			core->set_invalid_output(opt.invalid);
+	} else
+		core->record_bursts(opt.capfile != 0);
+
+	return core;
+}
+
+
+/*
+ * Feed the nitems items at base to the demodulator, starting at stream
+ * position from and stopping once past position to with no burst in
+ * progress.
+ *
+ * Stream positions count the history() - 1 zero items GNU Radio preloads a
+ * block's input with.  We do the same with a small head buffer so that sample
+ * numbers match a flowgraph run; past it, work() reads straight from the
+ * mapping.
+ */
+static void decode(omnipod_core *core, const char *base, unsigned long long nitems, unsigned long long from, unsigned long long to) {
+
+	unsigned int item_size = core->item_size(), pre = core->history() - 1;
+	unsigned int head_len = 0, n, used;
+	unsigned long long pos, total;
+	const char *p;
+	char *head = 0;
+
+
+	total = nitems + pre;
+
+	if(from < pre) {
+		head_len = BLOCK_LEN + pre;
+		if(head_len > total)
+			head_len = (unsigned int)total;
+		if(!(head = (char *)calloc(head_len, item_size))) {
+			throw std::runtime_error("error: cannot allocate head buffer");
+		}
+		memcpy(head + pre * item_size, base, (head_len - pre) * item_size);
+	}
+
+	core->set_start(from);
+	for(pos = from; pos < total;) {
+		if(pos < pre) {
+			// still inside the head buffer
+			p = head + pos * item_size;
+			n = head_len - (unsigned int)pos;
+		} else {
+			p = base + (pos - pre) * item_size;
+			n = (total - pos > BLOCK_LEN + pre)? BLOCK_LEN + pre : (unsigned int)(total - pos);
+		}
+		if(!(used = core->work(p, n)))
+			break;
+		pos += used;
+		if(pos >= to && !core->busy())
+			break;
+	}
+
+	if(head)
+		free(head);
+}
+
+
+/*
+ * Burst start numbers are signed in effect; the first bursts of a file can
+ * start "before" it.
+ */
+static int owned(const pool *pl, unsigned int k, unsigned long long start) {
+
+	long long s = (long long)start;
+
+	if(k > 0 && s < (long long)pl->chunks[k].begin)
+		return 0;
+	if(k + 1 < pl->chunks.size() && s >= (long long)pl->chunks[k].end)
+		return 0;
+	return 1;
+}
+
+
+static void *decode_worker(void *arg) {
+
+	pool *pl = (pool *)arg;
+	unsigned int k;
+	unsigned long long from, to, overlap, pre;
+	omnipod_core *core;
+
+
+	for(;;) {
+		pthread_mutex_lock(&pl->mutex);
+		k = pl->next;
+		if(k < pl->chunks.size())
+			pl->next += 1;
+		pthread_mutex_unlock(&pl->mutex);
+		if(k >= pl->chunks.size())
+			break;
+
+		chunk &c = pl->chunks[k];
+		try {
+			core = make_core(*pl->opt, 0);
+			pre = core->history() - 1;
+			overlap = core->overlap();
+			from = c.begin + pre;
+			from = (from > overlap)? from - overlap : 0;
+			to = c.end + pre + overlap;
+			decode(core, pl->base, pl->nitems, from, to);
+			core->take_bursts(c.bursts);
+			delete core;
+		} catch(std::exception &e) {
+			c.error = e.what();
+		}
+
+		pthread_mutex_lock(&pl->mutex);
+		c.done = 1;
+		pthread_cond_broadcast(&pl->cond);
+		pthread_mutex_unlock(&pl->mutex);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Decode chunks on nthreads threads and write their bursts in order as each
+ * chunk completes.
+ */
+static void decode_parallel(const options &opt, omnipod_core *writer, const char *base, unsigned long long nitems, unsigned int nthreads) {
+
+	unsigned int i, k;
+	unsigned long long b;
+	std::vector<pthread_t> threads;
+	pool pl;
+
+
+	pl.opt = &opt;
+	pl.base = base;
+	pl.nitems = nitems;
+	pl.next = 0;
+	for(b = 0; b < nitems; b += CHUNK_LEN) {
+		pl.chunks.push_back(chunk());
+		pl.chunks.back().begin = b;
+		pl.chunks.back().end = (nitems - b > CHUNK_LEN)? b + CHUNK_LEN : nitems;
+		pl.chunks.back().done = 0;
+	}
+	if(nthreads > pl.chunks.size())
+		nthreads = pl.chunks.size();
+	pthread_mutex_init(&pl.mutex, 0);
+	pthread_cond_init(&pl.cond, 0);
+
+	threads.resize(nthreads);
+	for(i = 0; i < nthreads; i++) {
+		if(pthread_create(&threads[i], 0, decode_worker, &pl)) {
+			throw std::runtime_error("error: cannot create thread");
+		}
+	}
+
+	for(k = 0; k < pl.chunks.size(); k++) {
+		pthread_mutex_lock(&pl.mutex);
+		while(!pl.chunks[k].done)
+			pthread_cond_wait(&pl.cond, &pl.mutex);
+		pthread_mutex_unlock(&pl.mutex);
+
+		if(pl.chunks[k].error.size()) {
+			fprintf(stderr, "%s\n", pl.chunks[k].error.c_str());
+			break;
+		}
+		for(i = 0; i < pl.chunks[k].bursts.size(); i++)
+			if(owned(&pl, k, pl.chunks[k].bursts[i].start))
+				writer->emit(pl.chunks[k].bursts[i]);
+		std::vector<omnipod_burst>().swap(pl.chunks[k].bursts);
+	}
+
+	// on error, let the workers run out of chunks
+	pthread_mutex_lock(&pl.mutex);
+	pl.next = pl.chunks.size();
+	pthread_mutex_unlock(&pl.mutex);
+	for(i = 0; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+
+	pthread_cond_destroy(&pl.cond);
+	pthread_mutex_destroy(&pl.mutex);
+}
+
+
+static double elapsed(const struct timeval &start) {
+
+	struct timeval now;
+
+	gettimeofday(&now, 0);
+	return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+}
+
+
+/*
+ * Map a file read-only.  Returns 0 for an empty file.
+ */
+static void *map_file(const char *filename, unsigned long long &size) {
+
+	int fd;
+	struct stat st;
+	void *base;
+
+	if((fd = open(filename, O_RDONLY)) == -1) {
+		perror(filename);
+		throw std::runtime_error("error: cannot open input");
+	}
+	if(fstat(fd, &st) == -1) {
+		perror(filename);
+		close(fd);
+		throw std::runtime_error("error: cannot stat input");
+	}
+	size = st.st_size;
+	if(!size) {
+		close(fd);
+		return 0;
+	}
+	if((base = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		perror(filename);
+		close(fd);
+		throw std::runtime_error("error: cannot map input");
+	}
+	close(fd);
+	madvise(base, size, MADV_SEQUENTIAL);
+
+	return base;
+}
+
+
+/*
+ * omnipod_demod::set_capture() names files
+ * <name>-<MHz>MHz-<decimation>.omnidump.  Captures are always gr_complex.
+ */
+static void parse_capture_name(const std::string &name, options &opt) {
+
+	std::string::size_type m, d;
+	double mhz;
+	unsigned int decimation;
+	char c;
+
+	if((m = name.rfind("MHz-")) == std::string::npos)
+		return;
+	if((d = name.rfind('-', m)) == std::string::npos)
+		return;
+	if(sscanf(name.c_str() + d + 1, "%lfMHz-%u.omnidum%c", &mhz, &decimation, &c) != 3 || c != 'p')
+		return;
+	if(mhz <= 0 || !decimation)
+		return;
+	opt.clock_speed = mhz * 1e6;
+	opt.decimation = decimation;
+	opt.short_input = 0;
+}
+
+
+static void add_file(std::vector<batch_file> &files, const std::string &name) {
+
+	struct stat st;
+	DIR *dir;
+	struct dirent *de;
+
+	if(stat(name.c_str(), &st) == -1) {
+		perror(name.c_str());
+		return;
+	}
+	if(S_ISREG(st.st_mode)) {
+		files.push_back(batch_file());
+		files.back().name = name;
+		files.back().size = st.st_size;
+		return;
+	}
+	if(!S_ISDIR(st.st_mode))
+		return;
+
+	// directories are not searched recursively
+	if(!(dir = opendir(name.c_str()))) {
+		perror(name.c_str());
+		return;
+	}
+	while((de = readdir(dir))) {
+		if(de->d_name[0] == '.')
+			continue;
+		std::string path = name + "/" + de->d_name;
+		if(stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode))
+			continue;
+		files.push_back(batch_file());
+		files.back().name = path;
+		files.back().size = st.st_size;
+	}
+	closedir(dir);
+}
+
+
+static void add_list(std::vector<batch_file> &files, const char *list) {
+
+	FILE *fp;
+	char buf[BUFSIZ];
+	unsigned int len;
+
+	if(!(fp = fopen(list, "r"))) {
+		perror(list);
+		throw std::runtime_error("error: cannot open list");
+	}
+	while(fgets(buf, sizeof(buf), fp)) {
+		len = strlen(buf);
+		while(len && (buf[len - 1] == '\n' || buf[len - 1] == '\r'))
+			buf[--len] = 0;
+		if(len)
+			add_file(files, buf);
+	}
+	fclose(fp);
+}
+
+
+static int bigger(const batch_file &a, const batch_file &b) {
+
+	return a.size > b.size;
+}
+
+
+static void decode_file(batch *bt, const batch_file &f) {
+
+	unsigned long long size, nitems, bursts;
+	void *base = 0;
+	const char *p;
+	std::string out, capfile, invalid;
+	std::vector<omnipod_burst> recorded;
+	omnipod_core *core = 0, *writer;
+	struct timeval start;
+	double t;
+	options opt = *bt->opt;
+	unsigned int i;
+
+
+	gettimeofday(&start, 0);
+	parse_capture_name(f.name, opt);
+
+	try {
+		base = map_file(f.name.c_str(), size);
+		if(bt->outdir) {
+			p = strrchr(f.name.c_str(), '/');
+			out = std::string(bt->outdir) + "/" + (p? p + 1 : f.name.c_str()) + ".txt";
+			opt.outfile = (char *)out.c_str();
+
+			// each capture's added representations, capture and invalid frames beside its output
+			for(i = 0; i < opt.also_file.size(); i++)
+				opt.also_file[i] = out + "." + opt.also_file[i];
+			if(opt.capfile) {
+				capfile = out + "." + opt.capfile;
+				opt.capfile = (char *)capfile.c_str();
+			}
+			if(opt.invalid) {
+				invalid = out + "." + opt.invalid;
+				opt.invalid = (char *)invalid.c_str();
+			}
+			core = make_core(opt, 1);
+			core->set_quiet();
+		} else
+			core = make_core(opt, 0);
+		nitems = size / core->item_size();
+		if(nitems)
+			decode(core, (const char *)base, nitems, 0, ~0ULL);
+		bursts = core->burst_count();
+		core->take_bursts(recorded);
+		delete core;
+		core = 0;
+		if(base)
+			munmap(base, size);
+		base = 0;
+	} catch(std::exception &e) {
+		if(core)
+			delete core;
+		if(base)
+			munmap(base, size);
+		pthread_mutex_lock(&bt->mutex);
+		fprintf(stderr, "%s: %s\n", f.name.c_str(), e.what());
+		bt->done += 1;
+		bt->errors += 1;
+		pthread_mutex_unlock(&bt->mutex);
+		return;
+	}
+
+	pthread_mutex_lock(&bt->mutex);
+	if(!bt->outdir) {
+		try {
+			writer = make_core(opt, 1);
+			out = "file: " + f.name + "\n";
+			writer->print(out.c_str());
+			for(i = 0; i < recorded.size(); i++)
+				writer->emit(recorded[i]);
+			delete writer;
+		} catch(std::exception &e) {
+			fprintf(stderr, "%s: %s\n", f.name.c_str(), e.what());
+			bt->errors += 1;
+		}
+	}
+	t = elapsed(start);
+	bt->done += 1;
+	bt->items += nitems;
+	bt->bytes += size;
+	bt->bursts += bursts;
+	fprintf(stderr, "[%u/%u] %s: %llu samples, %llu bursts, %.1f Msamples/s\n", bt->done, bt->nfiles, f.name.c_str(), nitems, bursts, (t > 0)? nitems / t / 1e6 : 0);
+	pthread_mutex_unlock(&bt->mutex);
+}
+
+
+/*
+ * Take the biggest file from our own queue or, when it is empty, the
+ * smallest from someone else's.
+ */
+static int next_file(batch *bt, unsigned int self, batch_file &f) {
+
+	unsigned int i, v;
+	batch_queue *q;
+
+	q = bt->queues[self];
+	pthread_mutex_lock(&q->mutex);
+	if(q->files.size()) {
+		f = q->files.front();
+		q->files.pop_front();
+		pthread_mutex_unlock(&q->mutex);
+		return 1;
+	}
+	pthread_mutex_unlock(&q->mutex);
+
+	for(i = 1; i < bt->queues.size(); i++) {
+		v = (self + i) % bt->queues.size();
+		q = bt->queues[v];
+		pthread_mutex_lock(&q->mutex);
+		if(q->files.size()) {
+			f = q->files.back();
+			q->files.pop_back();
+			pthread_mutex_unlock(&q->mutex);
+			return 1;
+		}
+		pthread_mutex_unlock(&q->mutex);
+	}
+	return 0;
+}
+
+
+struct batch_thread {
+	batch *		bt;
+	unsigned int	self;
+};
+
+
+static void *batch_worker(void *arg) {
+
+	batch_thread *th = (batch_thread *)arg;
+	batch_file f;
+
+	while(next_file(th->bt, th->self, f))
+		decode_file(th->bt, f);
+
+	return 0;
+}
+
+
+static int decode_batch(const options &opt, const char *outdir, std::vector<batch_file> &files, unsigned int nthreads) {
+
+	unsigned int i;
+	double t;
+	std::vector<pthread_t> threads;
+	std::vector<batch_thread> th;
+	batch bt;
+
+
+	if(nthreads > files.size())
+		nthreads = files.size();
+	if(!nthreads)
+		return 0;
+
+	// deal the files out biggest first
+	std::sort(files.begin(), files.end(), bigger);
+	for(i = 0; i < nthreads; i++) {
+		bt.queues.push_back(new batch_queue);
+		pthread_mutex_init(&bt.queues[i]->mutex, 0);
+	}
+	for(i = 0; i < files.size(); i++)
+		bt.queues[i % nthreads]->files.push_back(files[i]);
+
+	bt.opt = &opt;
+	bt.outdir = outdir;
+	bt.nfiles = files.size();
+	bt.done = 0;
+	bt.errors = 0;
+	bt.items = 0;
+	bt.bytes = 0;
+	bt.bursts = 0;
+	gettimeofday(&bt.start, 0);
+	pthread_mutex_init(&bt.mutex, 0);
+
+	threads.resize(nthreads);
+	th.resize(nthreads);
+	for(i = 0; i < nthreads; i++) {
+		th[i].bt = &bt;
+		th[i].self = i;
+		if(pthread_create(&threads[i], 0, batch_worker, &th[i])) {
+			throw std::runtime_error("error: cannot create thread");
+		}
+	}
+	for(i = 0; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+
+	t = elapsed(bt.start);
+	fprintf(stderr, "%u files (%u failed), %llu samples, %llu bursts in %.1fs: %.1f Msamples/s, %.1f MB/s\n",
+	   bt.nfiles, bt.errors, bt.items, bt.bursts, t, (t > 0)? bt.items / t / 1e6 : 0, (t > 0)? bt.bytes / t / 1e6 : 0);
+
+	for(i = 0; i < nthreads; i++) {
+		pthread_mutex_destroy(&bt.queues[i]->mutex);
+		delete bt.queues[i];
+	}
+	pthread_mutex_destroy(&bt.mutex);
+
+	return bt.errors? -1 : 0;
+}
+
+
+int main(int argc, char **argv) {
+
+	int c, r = 0, profile = 0;
+	unsigned int nthreads = 1;
+	char *infile = 0, *list = 0, *outdir = 0, *p;
+	void *base;
+	unsigned long long size, nitems;
+	std::vector<batch_file> files;
+	options opt;
+	omnipod_core *core;
+
+
+	opt.clock_speed = 64e6;
+	opt.decimation = 256;
+	opt.short_input = 0;
+	opt.rep = REP_MANCHESTER;
+	opt.threshold = THRESHOLD_AVERAGE;
+	opt.hex = 0;
+	opt.power = 0;
+	opt.samples = 0;
+	opt.outfile = 0;
+	opt.capfile = 0;
+	opt.check = 0;
+	opt.invalid = 0;
+	opt.dedup = 0;
+	opt.messages = 0;
+	opt.burst_timeout = 0;
+	opt.max_burst = 0;
+
+	while((c = getopt(argc, argv, "f:L:O:F:d:So:r:t:Hpsc:V:i:D:M:E:m:A:j:Ph?")) != EOF) {
+		switch(c) {
+			case 'f':
+				infile = optarg;
+				break;
+			case 'L':
+				list = optarg;
+				break;
+			case 'O':
+				outdir = optarg;
+				break;
+			case 'F':
+				opt.clock_speed = strtod(optarg, 0);
+				break;
+			case 'd':
+				opt.decimation = strtoul(optarg, 0, 0);
+				break;
+			case 'S':
+				opt.short_input = 1;
+				break;
+			case 'o':
+				opt.outfile = optarg;
+				break;
+			case 'r':
+				if((opt.rep = parse_rep(optarg)) < 0) {
+					fprintf(stderr, "error: unknown representation\n");
+					return -1;
+				}
+				break;
+			case 't':
+				if((opt.threshold = parse_threshold(optarg)) < 0) {
+					fprintf(stderr, "error: unknown threshold\n");
+					return -1;
+				}
+				break;
+			case 'H':
+				opt.hex = 1;
+				break;
+			case 'p':
+				opt.power = 1;
+				break;
+			case 's':
+				opt.samples = 1;
+				break;
+			case 'c':
+				opt.capfile = optarg;
+				break;
+			case 'V':
+				opt.check = optarg;
+				break;
+			case 'i':
+				opt.invalid = optarg;
+				break;
+			case 'D':
+				opt.dedup = strtod(optarg, 0);
+				break;
+			case 'M':
+				opt.messages = strtod(optarg, 0);
+				break;
+			case 'E':
+				opt.burst_timeout = strtod(optarg, 0);
+				break;
+			case 'm':
+				opt.max_burst = strtod(optarg, 0);
+				break;
+			case 'A':
+				if(!(p = strchr(optarg, ':')) || !p[1] || p == optarg || parse_rep(optarg) < 0) {
+					fprintf(stderr, "error: -A takes <representation>:<file>\n");
+					return -1;
+				}
+				opt.also_rep.push_back(parse_rep(optarg));
+				opt.also_file.push_back(p + 1);
+				break;
+			case 'j':
+				nthreads = strtoul(optarg, 0, 0);
+				break;
+			case 'P':
+				profile = 1;
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if(!opt.decimation || opt.clock_speed <= 0)
+		usage(argv[0]);
+	if(infile && (optind != argc || list || outdir))
+		usage(argv[0]);
+	if(!infile && optind == argc && !list)
+		usage(argv[0]);
+	if(!nthreads) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (n > 0)? n : 1;
+	}
+
+	try {
+		if(!infile) {
+			if(list)
+				add_list(files, list);
+			for(; optind < argc; optind++)
+				add_file(files, argv[optind]);
+			r = decode_batch(opt, outdir, files, nthreads);
+		} else {
+			core = make_core(opt, 1);
+			if((base = map_file(infile, size))) {
+				nitems = size / core->item_size();
+				if(nthreads > 1)
+					decode_parallel(opt, core, (const char *)base, nitems, nthreads);
+				else if(nitems)
+					decode(core, (const char *)base, nitems, 0, ~0ULL);
+				munmap(base, size);
+			}
+			delete core;
+		}
+	} catch(std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return -1;
+	}
+
+	if(profile)
+		omnipod_profile_dump(stderr);
+
+	return r;
+}
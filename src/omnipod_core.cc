@@ -0,0 +1,3027 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/time.h>
+#include <stdexcept>
+#include "omnipod_core.h"
+#include "omnipod_profile.h"
+
+
+static double now() {
+
+	struct timeval tv;
+
+	gettimeofday(&tv, 0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+omnipod_core::omnipod_core(double clock_speed, unsigned int decimation, int short_input) {
+
+	m_clock_speed = clock_speed;
+	m_decimation = decimation;
+	m_sr = clock_speed / decimation;
+
+	if(m_sr < 8 * m_symbol_rate)
+		throw std::runtime_error("error: omnipod_core: sample rate too low");
+
+	m_sps_q16 = (unsigned int)lrint(m_sr / m_symbol_rate * 65536);
+	m_sps = (m_sps_q16 + 32768) >> 16;
+	m_jitter = m_sps / 4;
+	m_burst_sps = m_sps_q16;
+	m_phase = 0;
+	m_edges = 0;
+	m_anchored = 0;
+
+	m_average_len = m_avg_n * m_sps;	// average over m_avg_n symbols
+	m_average_a = 0;
+	m_average_b = 0;
+
+	m_short_input = short_input;
+	m_item_size = short_input? 2 * sizeof(short) : sizeof(omnipod_complex);
+	m_iaverage_a = 0;
+	m_iaverage_b = 0;
+
+	/*
+	 * The tracker moves towards a new extreme within a quarter symbol
+	 * and relaxes back over m_avg_n symbols, the same span the
+	 * averages use.
+	 */
+	m_threshold = THRESHOLD_AVERAGE;
+	m_delay = 2 * m_average_len;
+	m_high = 0;
+	m_low = 0;
+	m_attack = 1.0 - exp(-4.0 / m_sps);
+	m_decay = 1.0 - exp(-1.0 / m_average_len);
+
+	m_detector = 0;
+	m_sliced = 0;
+	m_burst_threshold = HUGE_VAL;
+	m_below = 0;
+	m_seed = 0;
+
+	m_sign = -1;
+	m_count = 0;
+	m_change_count = 0;
+	m_burst_timeout = UINT_MAX;
+	m_run_sum = m_change_sum = 0;
+	m_run_peak = m_change_peak = 0;
+	m_burst_sum = m_high_sum = m_low_sum = 0;
+	m_burst_n = m_high_n = m_low_n = 0;
+	m_burst_peak = 0;
+	m_noise = -1;
+	m_noise_len = 8 * m_average_len;
+	memset(&m_levels, 0, sizeof(m_levels));
+
+	m_dbuf_count = 0;
+	m_dbuf_grows = 0;
+
+	m_rep = REP_MANCHESTER;
+	m_sink = 0;
+	m_data_len = -1;
+	m_hex = 0;
+
+	m_fp = 0;
+	m_rfp = 0;
+
+	m_show_power = 0;
+	m_show_samples = 0;
+
+	m_starting = 1;
+	m_sample_base = 0;
+
+	m_record = 0;
+	m_record_capture = 0;
+	m_burst = 0;
+
+	m_quiet = 0;
+	m_nbursts = 0;
+
+	m_sample_number = 0;
+	m_signal_start = 0;
+	m_last_signal_start = 0;
+
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_sfp = 0;
+	m_stats_interval = 0;
+	m_stats_next = 0;
+
+	m_monitor = 0;
+	m_max_backlog = 0;
+	m_last_warning = 0;
+
+	m_work_time = 0;
+	m_symbol_time = 0;
+	m_write_time = 0;
+	m_output = 0;
+
+	m_tfp = 0;
+	m_ifp = 0;
+
+	m_snapshot_seconds = 0;
+	m_snapshot_end = 0;
+	m_snapshot_requested = 0;
+	m_request_seconds = 0;
+	pthread_mutex_init(&m_snapshot_mutex, 0);
+	m_invalid = 0;
+
+	if(!(m_cb = new circular_buffer(m_cb_len, m_item_size, 1))) {
+		throw std::runtime_error("error: cannot create circular buffer");
+	}
+	m_saved = 0;
+	m_signal_first = 0;
+	m_signal_len = 0;
+
+	// room for a burst of a few hundred bits to start with
+	m_max_symbols = m_initial_symbols;
+	fit_burst(m_initial_symbols);
+	set_max_burst(m_max_burst);
+}
+
+
+omnipod_core::~omnipod_core() {
+
+	if(m_fp)
+		fclose(m_fp);
+
+	if(m_rfp)
+		fclose(m_rfp);
+
+	if(m_sfp) {
+		write_stats();
+		fclose(m_sfp);
+	}
+
+	if(m_messages.pending() && !m_record) {
+		m_messages.flush(m_assembled);
+		show_messages();
+	}
+
+	for(unsigned int i = 0; i < m_sinks.size(); i++)
+		if(m_sinks[i].fp)
+			fclose(m_sinks[i].fp);
+
+	if(m_tfp)
+		fclose(m_tfp);
+
+	if(m_ifp)
+		fclose(m_ifp);
+
+	if(m_cb)
+		delete m_cb;
+
+	if(m_detector)
+		delete m_detector;
+
+	pthread_mutex_destroy(&m_snapshot_mutex);
+}
+
+
+void omnipod_core::set_representation(int rep) {
+
+	m_rep = (rep_type)rep;
+}
+
+
+/*
+ * The history depends on the threshold type, so this must be called before
+ * the first call to work().
+ */
+void omnipod_core::set_threshold(int threshold) {
+
+	switch(threshold) {
+		case THRESHOLD_AVERAGE:
+			m_delay = 2 * m_average_len;
+			break;
+
+		case THRESHOLD_TRACKER:
+			m_delay = 0;
+			break;
+
+		case THRESHOLD_MATCHED:
+			m_delay = 0;
+			if(!m_detector)
+				m_detector = new preamble_detector(m_sr / m_symbol_rate, m_match_score);
+			break;
+
+		default:
+			throw std::runtime_error("error: set_threshold: unknown threshold type");
+	}
+	m_threshold = (threshold_type)threshold;
+}
+
+
+/*
+ * Number of items work() needs to see at once, counting the current one.
+ * The caller must precede the first item with history() - 1 zero items.
+ */
+unsigned int omnipod_core::history() {
+
+	if(m_threshold == THRESHOLD_TRACKER || m_threshold == THRESHOLD_MATCHED)
+		return 1;
+	return 2 * m_average_len + 1 + 1;
+}
+
+
+unsigned int omnipod_core::item_size() {
+
+	return m_item_size;
+}
+
+
+void omnipod_core::show_hex() {
+
+	m_hex = 1;
+}
+
+
+void omnipod_core::set_output(char *filename) {
+
+	if(!(m_fp = fopen(filename, "a"))) {
+		throw std::runtime_error("error: set_output: cannot open file for writing");
+	}
+}
+
+
+/*
+ * Run rep on every burst as well, writing it to filename.  The added
+ * representations share the burst's Manchester decoding with the main one and
+ * write nothing else: the signal is saved, the frame checks counted and the
+ * counters kept only for the main representation, and an added frame that
+ * fails the checks is dropped.  When recording, filename may be 0 and the
+ * text is kept with the burst for the emit() of an instance that has the
+ * same representations added with files.
+ */
+void omnipod_core::add_representation(int rep, char *filename) {
+
+	omnipod_sink sink;
+
+	sink.rep = rep;
+	sink.fp = 0;
+	if(filename && !(sink.fp = fopen(filename, "a"))) {
+		throw std::runtime_error("error: add_representation: cannot open file for writing");
+	}
+	m_sinks.push_back(sink);
+}
+
+
+void omnipod_core::set_capture(char *filename) {
+
+	char buf[BUFSIZ];
+
+	snprintf(buf, sizeof(buf), "%s-%.1fMHz-%u.omnidump", filename, m_clock_speed / 1e6, m_decimation);
+	if(!(m_rfp = fopen(buf, "a"))) {
+		throw std::runtime_error("error: set_raw_output: cannot open file for writing");
+	}
+}
+
+
+void omnipod_core::show_power() {
+
+	m_show_power = 1;
+}
+
+
+void omnipod_core::show_samples() {
+
+	m_show_samples = 1;
+}
+
+
+/*
+ * Only write to the output file, not the screen.
+ */
+void omnipod_core::set_quiet() {
+
+	m_quiet = 1;
+}
+
+
+/*
+ * Add a line of text to the output.
+ */
+void omnipod_core::print(const char *text) {
+
+	do_printf("%s", text);
+}
+
+
+/*
+ * Number of bursts represented so far.
+ */
+unsigned long long omnipod_core::burst_count() {
+
+	return m_nbursts;
+}
+
+
+/*
+ * Levels of the last burst represented, or emitted when recording.
+ */
+omnipod_levels omnipod_core::burst_levels() {
+
+	return m_levels;
+}
+
+
+/*
+ * A copy of the counters; cheap enough to call from Python at any time.
+ */
+omnipod_stats omnipod_core::get_stats() {
+
+	omnipod_stats s = m_stats;
+
+	s.snapshots = m_snapshots.written();
+	s.snapshots_dropped = m_snapshots.dropped();
+	return s;
+}
+
+
+/*
+ * Append a line of counters to filename every interval seconds, checked at
+ * the end of each call to work(), and once more on close.
+ */
+void omnipod_core::set_stats_file(char *filename, double interval) {
+
+	if(!(m_sfp = fopen(filename, "a"))) {
+		throw std::runtime_error("error: set_stats_file: cannot open file for writing");
+	}
+	m_stats_interval = interval;
+	m_stats_next = now() + interval;
+}
+
+
+void omnipod_core::write_stats() {
+
+	struct timeval tv;
+	omnipod_stats s = get_stats();
+
+	gettimeofday(&tv, 0);
+	fprintf(m_sfp, "%ld.%06ld samples %llu transitions %llu runs %llu %llu %llu %llu %llu %llu half %llu %llu %llu rejected %llu "
+	   "bursts %llu %llu truncated %llu timeout %llu grows %llu errors %llu %llu %llu preamble %llu %llu frames %llu %llu repeats %llu %llu %llu "
+	   "messages %llu %llu %llu %llu snapshots %llu %llu represent %.6f "
+	   "calls %llu rtf %.4f recent %.4f worst %.6f %llu warnings %llu %llu\n",
+	   (long)tv.tv_sec, (long)tv.tv_usec, s.samples, s.transitions, s.runs[1], s.runs[2], s.runs[3], s.runs[4], s.runs[5], s.runs[6],
+	   s.half_runs[0], s.half_runs[1], s.half_runs[2], s.rejected, s.bursts_started, s.bursts_finished, s.bursts_truncated,
+	   s.bursts_timed_out, s.buffer_grows,
+	   s.errors_phase, s.errors_impossible, s.errors_unknown, s.preamble_hits, s.preamble_misses, s.frames_checked, s.frames_invalid,
+	   s.repeat_lookups, s.repeats, s.repeat_evictions,
+	   s.messages_complete, s.messages_incomplete, s.message_gaps, s.message_out_of_order, s.snapshots, s.snapshots_dropped,
+	   s.represent_time,
+	   s.work_calls, s.samples? s.work_time * m_sr / s.samples : 0, s.recent_rtf, s.worst_call, s.worst_call_items,
+	   s.lag_warnings, s.backlog_warnings);
+	fflush(m_sfp);
+}
+
+
+/*
+ * Warn on stderr when work() is using more time than the samples it is given
+ * represent, or is handed more than max_backlog seconds of input at once.
+ * Only meaningful for a live source; the timing itself is always kept.
+ */
+void omnipod_core::monitor_realtime(double max_backlog) {
+
+	m_monitor = 1;
+	m_max_backlog = max_backlog;
+}
+
+
+/*
+ * Called at the end of each work() call that was given nitems and used n.
+ * recent_rtf is smoothed over about a second of samples, so a single slow
+ * call (a burst being written, say) does not count as lag.
+ */
+void omnipod_core::check_realtime(unsigned int nitems, unsigned int n) {
+
+	static const double warning_interval = 10;	// seconds between warnings
+
+	double end = now(), t = end - m_work_time, budget = n / m_sr, w;
+
+	m_stats.work_calls += 1;
+	m_stats.work_time += t;
+	if(t > m_stats.worst_call) {
+		m_stats.worst_call = t;
+		m_stats.worst_call_items = nitems;
+	}
+	if(budget > 0) {
+		w = 1.0 - exp(-budget);
+		m_stats.recent_rtf += w * (t / budget - m_stats.recent_rtf);
+	}
+
+	if(!m_monitor || end - m_last_warning < warning_interval)
+		return;
+
+	if(m_stats.recent_rtf > 1) {
+		m_stats.lag_warnings += 1;
+		m_last_warning = end;
+		fprintf(stderr, "omnipod: warning: type=lag recent_rtf=%.3f rtf=%.3f worst_call=%.6f sample=%llu\n",
+		   m_stats.recent_rtf, m_stats.work_time * m_sr / m_stats.samples, m_stats.worst_call, m_sample_number);
+	} else if(m_max_backlog > 0 && nitems / m_sr > m_max_backlog) {
+		m_stats.backlog_warnings += 1;
+		m_last_warning = end;
+		fprintf(stderr, "omnipod: warning: type=backlog items=%u seconds=%.3f max=%.3f sample=%llu\n",
+		   nitems, nitems / m_sr, m_max_backlog, m_sample_number);
+	}
+}
+
+
+/*
+ * Seconds under which fraction p of bursts were written, 0 <= p <= 1.
+ */
+double omnipod_core::latency(int stage, double p) {
+
+	if(stage < 0 || stage >= LATENCY_STAGES)
+		throw std::runtime_error("error: latency: unknown stage");
+	return m_latency[stage].percentile(p);
+}
+
+
+unsigned long long omnipod_core::latency_count() {
+
+	return m_latency[LATENCY_TOTAL].count();
+}
+
+
+void omnipod_core::reset_latency() {
+
+	unsigned int i;
+
+	for(i = 0; i < LATENCY_STAGES; i++)
+		m_latency[i].reset();
+}
+
+
+/*
+ * Append the recent slicer decisions to filename.  Can be called from any
+ * thread while work() runs.
+ */
+void omnipod_core::dump_trace(char *filename) {
+
+	FILE *fp;
+
+	if(!(fp = fopen(filename, "a"))) {
+		throw std::runtime_error("error: dump_trace: cannot open file for writing");
+	}
+	m_trace.dump(fp, "requested");
+	fclose(fp);
+}
+
+
+/*
+ * Where trigger() dumps the trace, such as when a preamble is found but the
+ * data following it has decoding errors.
+ */
+void omnipod_core::set_trace_file(char *filename) {
+
+	if(!(m_tfp = fopen(filename, "a"))) {
+		throw std::runtime_error("error: set_trace_file: cannot open file for writing");
+	}
+}
+
+
+/*
+ * Write the last seconds of raw input, as far back as m_cb goes, to
+ * filename-<first sample>-<samples>-<MHz>MHz-<decimation>.omnidump.  Can be
+ * called from any thread while work() runs; the samples are taken at the
+ * start of the next call and written without holding it up.  A second call
+ * before then replaces the first.
+ */
+void omnipod_core::snapshot(char *filename, double seconds) {
+
+	pthread_mutex_lock(&m_snapshot_mutex);
+	m_request_prefix = filename;
+	m_request_seconds = seconds;
+	m_snapshot_requested = 1;
+	pthread_mutex_unlock(&m_snapshot_mutex);
+}
+
+
+/*
+ * Have trigger() take a snapshot as well, of the last seconds before it,
+ * named as for snapshot().  0 seconds turns it off.
+ */
+void omnipod_core::set_snapshot(char *filename, double seconds) {
+
+	m_snapshot_prefix = filename;
+	m_snapshot_seconds = seconds;
+}
+
+
+/*
+ * Checks the data after the preamble must pass before REP_MANCHESTER_STRICT,
+ * REP_DECODE or REP_SOFT format or save a burst; see frame_check.h for the
+ * spec.  Frames that fail are counted and dropped, or written to the file
+ * given to set_invalid_output().
+ */
+void omnipod_core::set_frame_check(char *spec) {
+
+	m_frame.configure(spec);
+}
+
+
+void omnipod_core::set_invalid_output(char *filename) {
+
+	if(!(m_ifp = fopen(filename, "a"))) {
+		throw std::runtime_error("error: set_invalid_output: cannot open file for writing");
+	}
+}
+
+
+/*
+ * Returns 1 if the burst should be formatted: its frame passed, or there is
+ * somewhere to send it that failed.  A recorded burst is always formatted and
+ * left to emit().
+ */
+int omnipod_core::validate(const char *bits, unsigned int nbits, unsigned int markers) {
+
+	if(!m_frame.enabled())
+		return 1;
+	if(m_sink)
+		return m_frame.check(bits, nbits, markers);
+	m_stats.frames_checked += 1;
+	if(m_frame.check(bits, nbits, markers))
+		return 1;
+	m_stats.frames_invalid += 1;
+	m_invalid = 1;
+	if(m_burst) {
+		m_burst->invalid = 1;
+		return 1;
+	}
+	return m_ifp != 0;
+}
+
+
+/*
+ * A burst with the same symbols as one that started less than seconds before
+ * it is not decoded or saved again; a line giving the number of the repeat
+ * and where the first copy started is written in its place.  0 turns this
+ * off.
+ */
+void omnipod_core::set_repeat_window(double seconds) {
+
+	m_repeats.set_window((unsigned long long)(seconds * m_sr));
+}
+
+
+/*
+ * Returns 1 if the burst starting at m_signal_start is a repeat, having
+ * written it out as one.
+ */
+int omnipod_core::repeat(unsigned long long hash) {
+
+	burst_cache_entry *e;
+
+	m_stats.repeat_lookups += 1;
+	if(!(e = m_repeats.find(hash, m_signal_start)))
+		return 0;
+	m_stats.repeats += 1;
+	e->repeats += 1;
+
+	// goes wherever the first copy went
+	m_invalid = e->invalid;
+	if(m_show_samples)
+		show_sample();
+	do_printf("repeat %u of burst at sample %llu\n", e->repeats, e->first);
+	m_invalid = 0;
+	return 1;
+}
+
+
+void omnipod_core::remember(unsigned long long hash) {
+
+	if(m_repeats.insert(hash, m_signal_start, m_invalid))
+		m_stats.repeat_evictions += 1;
+}
+
+
+/*
+ * Put messages sent over several REP_DECODE bursts back together; see
+ * message_assembler.h.  Each is written as a line
+ *
+ *	M: <sender> <bursts> <first seq>-<last seq> <missing> <bits> <hex> <how>
+ *
+ * when its last burst arrives, or timeout seconds after its latest burst if
+ * the last never does.  The hex is the bits after each burst's header, run
+ * together and padded with zeros to a whole digit.  0 turns this off.
+ */
+void omnipod_core::set_reassembly(double timeout) {
+
+	m_messages.set_timeout((unsigned long long)(timeout * m_sr));
+}
+
+
+/*
+ * The longest burst decoded whole; a longer one is represented in pieces of
+ * that length.  The symbol buffers grow to fit as far as this, m_cb is made
+ * long enough to hold a burst this long and a quarter second after it, and
+ * omnidecode's chunks overlap by twice it.
+ */
+void omnipod_core::set_max_burst(double seconds) {
+
+	circular_buffer *cb;
+	unsigned int len, nitems;
+	void *buf;
+
+	if(seconds > m_max_burst_limit)
+		seconds = m_max_burst_limit;
+
+	// every entry in m_dbuf is at least half a symbol
+	m_max_symbols = (unsigned int)(2 * seconds * m_symbol_rate);
+	if(m_max_symbols < m_initial_symbols)
+		m_max_symbols = m_initial_symbols;
+	m_max_signal = (unsigned int)(seconds * m_sr * (1 + m_max_drift)) + 8 * m_average_len;
+
+	// a new m_cb keeps what the old one held, so views into it still hold
+	len = m_max_signal + (unsigned int)(m_sr / 4);
+	if(len > m_cb->buf_len()) {
+		cb = new circular_buffer(len, m_item_size, 1);
+		buf = m_cb->peek(&nitems);
+		cb->write(buf, nitems);
+		delete m_cb;
+		m_cb = cb;
+	}
+
+	// the samples that go unchecked between one run and the next
+	m_pin_len = m_cb->buf_len() - 2 * (m_jitter + 1);
+}
+
+
+/*
+ * A burst normally ends when slice() is handed a run of no valid width, which
+ * on a quiet channel may be long after the carrier stops.  With a timeout it
+ * ends as soon as the run has lasted that many symbols.  No run slice()
+ * accepts is longer than m_avg_n - 1 symbols, so shorter timeouts are taken
+ * as that; 0 turns this off.
+ */
+void omnipod_core::set_burst_timeout(double symbols) {
+
+	if(symbols <= 0) {
+		m_burst_timeout = UINT_MAX;
+		return;
+	}
+	if(symbols < m_avg_n - 1)
+		symbols = m_avg_n - 1;
+	m_burst_timeout = (unsigned int)ceil(symbols * m_sr / m_symbol_rate);
+}
+
+
+/*
+ * Adds the frame of the burst starting at m_signal_start.
+ */
+void omnipod_core::assemble(const std::string &frame) {
+
+	switch(m_messages.add(m_signal_start, frame.data(), frame.size(), m_assembled)) {
+		case FRAME_GAP:
+			m_stats.message_gaps += 1;
+			break;
+		case FRAME_OUT_OF_ORDER:
+			m_stats.message_out_of_order += 1;
+			break;
+	}
+	show_messages();
+}
+
+
+void omnipod_core::expire_messages(unsigned long long sample) {
+
+	m_messages.expire(sample, m_assembled);
+	show_messages();
+}
+
+
+void omnipod_core::show_messages() {
+
+	static const char *how[] = { "complete", "timeout", "evicted", "overflow" };
+	unsigned int i, j, k, h;
+
+	for(i = 0; i < m_assembled.size(); i++) {
+		const assembled_message &m = m_assembled[i];
+
+		if(m.status == MESSAGE_COMPLETE)
+			m_stats.messages_complete += 1;
+		else
+			m_stats.messages_incomplete += 1;
+
+		do_printf("M: %8.8x %u %2.2x-%2.2x %u %u ", m.sender, m.bursts, m.first_seq, m.last_seq, m.missing, (unsigned int)m.bits.size());
+		for(j = 0; j < m.bits.size(); j += 4) {
+			for(h = 0, k = 0; k < 4; k++)
+				h = (h << 1) | (j + k < m.bits.size() && m.bits[j + k] == '1');
+			do_printf("%x", h);
+		}
+		do_printf(" %s\n", how[m.status]);
+	}
+	m_assembled.clear();
+}
+
+
+void omnipod_core::trigger(const char *reason) {
+
+	char buf[BUFSIZ];
+
+	if(m_sink)
+		return;
+	if(m_snapshot_seconds > 0)
+		take_snapshot(m_snapshot_prefix, m_snapshot_seconds, 1);
+	if(!m_tfp)
+		return;
+	m_trace.add(TRACE_TRIGGER, m_signal_start, threshold_level(), 0, 0, 0);
+	snprintf(buf, sizeof(buf), "%s in burst at sample %llu", reason, m_signal_start);
+	m_trace.dump(m_tfp, buf);
+}
+
+
+/*
+ * Copies the last seconds of input out of m_cb and hands them to the writer.
+ * With follow, the copy starts no earlier than where the last one with
+ * follow ended, so a run of triggers gives files that follow on from each
+ * other rather than overlapping.
+ */
+void omnipod_core::take_snapshot(const std::string &prefix, double seconds, int follow) {
+
+	std::vector<omnipod_complex> samples;
+	unsigned long long first;
+	unsigned int nitems, n;
+	char name[BUFSIZ];
+	char *buf;
+
+	if(seconds <= 0)
+		return;
+	buf = (char *)m_cb->peek(&nitems);
+	n = (seconds * m_sr < nitems)? (unsigned int)(seconds * m_sr) : nitems;
+	if(follow && m_saved - n < m_snapshot_end)
+		n = m_saved - m_snapshot_end;
+
+	// numbered as the bursts' starting samples are
+	if(m_sample_number < m_delay + n)
+		n = (m_sample_number > m_delay)? m_sample_number - m_delay : 0;
+	if(!n)
+		return;
+	if(follow)
+		m_snapshot_end = m_saved;
+	first = m_sample_number - m_delay - n;
+
+	samples.resize(n);
+	signal_to_complex(buf + (nitems - n) * m_item_size, n, &samples[0], n);
+	snprintf(name, sizeof(name), "%s-%llu-%u-%.1fMHz-%u.omnidump", prefix.c_str(), first, n, m_clock_speed / 1e6, m_decimation);
+	m_snapshots.write(name, samples);
+}
+
+
+/*
+ * The threshold slice() is comparing against at the moment, in the units of
+ * the envelope (int16 counts for short input).
+ */
+float omnipod_core::threshold_level() {
+
+	double level;
+
+	if(m_threshold == THRESHOLD_MATCHED)
+		return m_burst_threshold;
+	if(m_threshold == THRESHOLD_TRACKER)
+		level = (m_high + m_low) / 2;
+	else if(m_short_input)
+		level = (double)((m_dbuf_count <= 2 * m_avg_n)? m_iaverage_a : m_iaverage_b) / m_average_len;
+	else
+		return ((m_dbuf_count <= 2 * m_avg_n)? m_average_a : m_average_b) / m_average_len;
+
+	// imag_approx() is scaled by 128
+	return m_short_input? level / 128 : level;
+}
+
+
+/*
+ * Count the error markers manchester_decode() left in data.
+ */
+void omnipod_core::count_errors(const char *data, unsigned int data_len) {
+
+	unsigned int i;
+
+	for(i = 0; i < data_len; i++) {
+		switch(data[i]) {
+			case '*':
+				m_stats.errors_phase += 1;
+				break;
+			case '#':
+				m_stats.errors_impossible += 1;
+				break;
+			case 'X':
+				m_stats.errors_unknown += 1;
+				break;
+		}
+	}
+}
+
+
+/*
+ * Collect each burst as an omnipod_burst instead of writing it out.  The
+ * caller takes them with take_bursts() and later writes them with emit().
+ * If capture is set the burst samples are kept as well.
+ */
+void omnipod_core::record_bursts(int capture) {
+
+	m_record = 1;
+	m_record_capture = capture;
+}
+
+
+void omnipod_core::take_bursts(std::vector<omnipod_burst> &bursts) {
+
+	bursts.swap(m_bursts);
+	m_bursts.clear();
+}
+
+
+/*
+ * Write out a burst recorded by another instance as if this instance had
+ * demodulated it.  The time since the previous burst is worked out here, so
+ * every recorded burst must be passed in order, including ones with no
+ * text.
+ */
+void omnipod_core::emit(const omnipod_burst &burst) {
+
+	unsigned int i;
+
+	m_last_signal_start = m_signal_start;
+	m_signal_start = burst.start;
+	m_levels = burst.levels;
+
+	if(m_messages.pending())
+		expire_messages(burst.start);
+
+	if(burst.hash && m_repeats.enabled() && repeat(burst.hash))
+		return;
+
+	m_invalid = burst.invalid;
+	if(burst.hash && m_repeats.enabled())
+		remember(burst.hash);
+	for(i = 0; i < burst.pieces.size(); i++) {
+		m_sink = burst.pieces[i].sink;
+		if(m_sink > (int)m_sinks.size() || (!m_sink && m_invalid && !m_ifp))
+			continue;
+		switch(burst.pieces[i].type) {
+			case PIECE_TEXT:
+				do_printf("%s", burst.pieces[i].text.c_str());
+				break;
+
+			case PIECE_STDOUT:
+				if(!m_quiet)
+					fputs(burst.pieces[i].text.c_str(), stdout);
+				break;
+
+			case PIECE_SAMPLE:
+				show_sample();
+				break;
+		}
+	}
+	m_sink = 0;
+	m_invalid = 0;
+
+	if(burst.frame.size() && m_messages.enabled())
+		assemble(burst.frame);
+
+	if(burst.save && m_rfp) {
+		capture_begin();
+		fwrite(&burst.signal[0], sizeof(omnipod_complex), burst.signal.size(), m_rfp);
+		capture_end();
+	}
+}
+
+
+/*
+ * The first item passed to work() is item sample of the input stream,
+ * counting the history() - 1 items of preload.  Lets a file be decoded in
+ * pieces with sample numbers that match decoding it whole.
+ */
+void omnipod_core::set_start(unsigned long long sample) {
+
+	m_sample_base = sample;
+	m_sample_number = sample;
+}
+
+
+/*
+ * Items that must be decoded ahead of a position for the state there to be
+ * the same as when decoding from the start: the history plus two of the
+ * longest bursts slice() will collect before forcing represent().
+ */
+unsigned int omnipod_core::overlap() {
+
+	return history() + 2 * m_max_symbols * m_sps;
+}
+
+
+/*
+ * A burst is in progress.
+ */
+int omnipod_core::busy() {
+
+	return m_dbuf_count > 0 || m_burst_threshold != HUGE_VAL;
+}
+
+
+void omnipod_core::add_piece(int type, const char *text) {
+
+	if(type == PIECE_TEXT && m_burst->pieces.size() && m_burst->pieces.back().type == PIECE_TEXT && m_burst->pieces.back().sink == m_sink) {
+		m_burst->pieces.back().text += text;
+		return;
+	}
+	m_burst->pieces.push_back(omnipod_piece());
+	m_burst->pieces.back().type = type;
+	m_burst->pieces.back().sink = m_sink;
+	m_burst->pieces.back().text = text;
+}
+
+
+void omnipod_core::show_sample() {
+
+	if(m_burst) {
+		add_piece(PIECE_SAMPLE, "");
+		return;
+	}
+	do_printf("sample: %9llu (%.1lfms)\t", m_signal_start, 1000.0 * (double)(m_signal_start - m_last_signal_start) / m_sr);
+}
+
+
+/*
+ * Diagnostics that only go to the screen.
+ */
+void omnipod_core::do_printf_stdout(const char *fmt, ...) {
+
+	va_list ap;
+	char buf[BUFSIZ];
+
+	if(m_sink)
+		return;
+	va_start(ap, fmt);
+	if(m_burst) {
+		vsnprintf(buf, sizeof(buf), fmt, ap);
+		add_piece(PIECE_STDOUT, buf);
+	} else if(!m_quiet)
+		vprintf(fmt, ap);
+	va_end(ap);
+}
+
+
+void omnipod_core::do_printf(const char *fmt, ...) {
+
+	va_list ap;
+	char buf[BUFSIZ];
+	double start;
+
+	m_output = 1;
+	if(m_burst) {
+		va_start(ap, fmt);
+		vsnprintf(buf, sizeof(buf), fmt, ap);
+		va_end(ap);
+		add_piece(PIECE_TEXT, buf);
+		return;
+	}
+
+	start = now();
+	if(m_sink) {
+		if(m_sinks[m_sink - 1].fp) {
+			va_start(ap, fmt);
+			vfprintf(m_sinks[m_sink - 1].fp, fmt, ap);
+			va_end(ap);
+		}
+		m_write_time += now() - start;
+		return;
+	}
+
+	if(m_invalid) {
+		if(m_ifp) {
+			va_start(ap, fmt);
+			vfprintf(m_ifp, fmt, ap);
+			va_end(ap);
+		}
+		m_write_time += now() - start;
+		return;
+	}
+
+	if(!m_quiet) {
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+	}
+
+	if(m_fp) {
+		va_start(ap, fmt);
+		vfprintf(m_fp, fmt, ap);
+		va_end(ap);
+	}
+	m_write_time += now() - start;
+}
+
+
+void omnipod_core::display_hex(char *data, unsigned int data_len) {
+
+	unsigned int i, h = 0, h_count = 0, first = 1;
+
+	for(i = 0; i < data_len; i++) {
+		h = (h << 1) | data[i];
+		h_count += 1;
+		if(h_count >= 32) {
+			if(!first)
+				do_printf(" ");
+			else
+				first = 0;
+			do_printf("%8.8x", h);
+			h = 0;
+			h_count = 0;
+		}
+	}
+	if(h_count) {
+		h = h << (32 - h_count);
+		if(!first)
+			do_printf(" ");
+		do_printf("%8.8x", h);
+	}
+}
+
+
+void omnipod_core::display_c_hex(char *data, unsigned int data_len) {
+
+	unsigned i, h = 0, h_count = 0, first = 1;
+
+	for(i = 0; i < data_len; i++) {
+		if((data[i] == '0') || (data[i] == '1')) {
+			h = (h << 1) | (data[i] - '0');
+			h_count += 1;
+			if(h_count >= 32) {
+				if(!first)
+					do_printf(" ");
+				else
+					first = 0;
+				do_printf("%8.8x", h);
+				h = 0;
+				h_count = 0;
+			}
+		} else {
+			if(h_count) {
+				h = h << (32 - h_count);
+				if(!first)
+					do_printf(" ");
+				else
+					first = 0;
+				do_printf("%8.8x", h);
+				h = 0;
+				h_count = 0;
+			}
+			if(!first)
+				do_printf(" ");
+			else
+				first = 0;
+			do_printf("%c", data[i]);
+		}
+	}
+	if(h_count) {
+		h = h << (32 - h_count);
+		if(!first)
+			do_printf(" ");
+		do_printf("%8.8x", h);
+	}
+}
+
+
+void omnipod_core::display_c_hex_bytes_le(char *data, unsigned int data_len) {
+
+	unsigned int i, h = 0, h_count = 0, b_count = 0;
+
+	for(i = 0; i < data_len; i++) {
+		if((data[i] == '0') || (data[i] == '1')) {
+			h = h | ((data[i] - '0') << h_count);
+			h_count += 1;
+			if(h_count >= 8) {
+				if((b_count > 0) && (b_count % 4 == 0))
+					do_printf(" ");
+				do_printf("%2.2x", h);
+				b_count += 1;
+				h = 0;
+				h_count = 0;
+			}
+		} else {
+			if(h_count > 0) {
+				if((b_count > 0) && (b_count % 4 == 0))
+					do_printf(" ");
+				do_printf("%2.2x", h);
+				b_count += 1;
+				h = 0;
+				h_count = 0;
+			}
+			if(b_count > 0)
+				do_printf(" ");
+			do_printf("%c", data[i]);
+			b_count = 4;
+		}
+	}
+	if(h_count > 0) {
+		if((b_count > 0) && (b_count % 4 == 0))
+			do_printf(" ");
+		do_printf("%2.2x", h);
+	}
+}
+
+
+void omnipod_core::display_c_hex_bytes(char *data, unsigned int data_len) {
+
+	unsigned int i, h = 0, h_count = 0, b_count = 0;
+
+	for(i = 0; i < data_len; i++) {
+		if((data[i] == '0') || (data[i] == '1')) {
+			h = (h << 1) | (data[i] - '0');
+			h_count += 1;
+			if(h_count >= 8) {
+				if((b_count > 0) && (b_count % 4 == 0))
+					do_printf(" ");
+				do_printf("%2.2x", h);
+				b_count += 1;
+				h = 0;
+				h_count = 0;
+			}
+		} else {
+			if(h_count > 0) {
+				h = h << (8 - h_count);
+				if((b_count > 0) && (b_count % 4 == 0))
+					do_printf(" ");
+				do_printf("%2.2x", h);
+				b_count += 1;
+				h = 0;
+				h_count = 0;
+			}
+			if(b_count > 0)
+				do_printf(" ");
+			do_printf("%c", data[i]);
+			b_count = 4;
+		}
+	}
+	if(h_count > 0) {
+		h = h << (8 - h_count);
+		if((b_count > 0) && (b_count % 4 == 0))
+			do_printf(" ");
+		do_printf("%2.2x", h);
+	}
+}
+
+
+/*
+ * Convert saved input items to omnipod_complex.  Returns the number of items
+ * converted, at most out_len.
+ */
+unsigned int omnipod_core::signal_to_complex(const void *buf, unsigned int nitems, omnipod_complex *out, unsigned int out_len) {
+
+	unsigned int i;
+	const short *ins;
+
+	if(nitems > out_len)
+		nitems = out_len;
+	if(!m_short_input) {
+		memcpy(out, buf, nitems * sizeof(omnipod_complex));
+		return nitems;
+	}
+	ins = (const short *)buf;
+	for(i = 0; i < nitems; i++)
+		out[i] = omnipod_complex(ins[2 * i], ins[2 * i + 1]);
+	return nitems;
+}
+
+
+void omnipod_core::capture_begin() {
+
+	unsigned int i;
+	omnipod_complex zero = 0;
+
+	// every burst is replayed from the lows the averager needs before it
+	for(i = 0; i < 2 * m_average_len; i++)
+		fwrite(&zero, sizeof(omnipod_complex), 1, m_rfp);
+}
+
+
+void omnipod_core::capture_end() {
+
+	unsigned int i;
+	omnipod_complex zero = 0, one = 1;
+
+	// need to make sure that slice() is called before eof
+	for(i = 0; i < 4 * m_average_len; i++)
+		fwrite(&zero, sizeof(omnipod_complex), 1, m_rfp);
+	for(i = 0; i < 4 * m_average_len; i++)
+		fwrite(&one, sizeof(omnipod_complex), 1, m_rfp);
+}
+
+
+void omnipod_core::save_signal() {
+
+	PROFILE_SCOPE(PROFILE_SAVE_SIGNAL);
+	unsigned int i, n, nitems;
+	omnipod_complex cbuf[512];
+	char *buf;
+
+	// failed the frame checks, or not the main representation
+	if(m_invalid || m_sink)
+		return;
+
+	if(m_burst) {
+		m_burst->save = 1;
+		if(!m_record_capture)
+			return;
+	} else if(!m_rfp)
+		return;
+
+	// captures are always written as omnipod_complex
+	if(!m_burst)
+		capture_begin();
+	buf = signal_samples(&nitems);
+	for(i = 0; i < nitems; i += n) {
+		n = signal_to_complex(buf + i * m_item_size, nitems - i, cbuf, sizeof(cbuf) / sizeof(*cbuf));
+		if(m_burst)
+			m_burst->signal.insert(m_burst->signal.end(), cbuf, cbuf + n);
+		else
+			fwrite(cbuf, sizeof(omnipod_complex), n, m_rfp);
+	}
+	if(!m_burst)
+		capture_end();
+}
+
+
+static int do_put(char *buf, unsigned int bufsize, unsigned int &o, const char *c) {
+
+	unsigned int s = strlen(c);
+
+	if(o + s < bufsize - 1) {
+		memcpy(buf + o, c, s);
+		o += s;
+		return 0;
+	}
+	return 1;
+}
+
+
+unsigned int omnipod_core::manchester_decode(unsigned char *dbuf, unsigned int dbuf_count, char *data, unsigned int max_data_len) {
+
+	unsigned int data_len, i;
+
+	data_len = 0;
+	for(i = 0; i < dbuf_count - 1;) {
+		switch(dbuf[i]) {
+			case 0: // 0
+				switch(dbuf[i + 1]) {
+					case 0:		// 0 0		error no phase change; perhaps missed first symbol
+						do_put(data, max_data_len, data_len, "*");
+						i += 1;
+						break;
+					case 1:		// 0 1
+						do_put(data, max_data_len, data_len, "0");
+						i += 2;
+						break;
+					case 2:		// 0 v		impossible error
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 3:		// 0 ^		error violation in center; perhaps missed first symbol
+						do_put(data, max_data_len, data_len, "*");
+						i += 1;
+						break;
+					case 4:		// 0 0 v	impossible error
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 5:		// 0 1 ^
+						do_put(data, max_data_len, data_len, "0^");
+						i += 2;
+						break;
+					case 6:		// 0 0 v 0	impossible error
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 7:		// 0 1 ^ 1
+						do_put(data, max_data_len, data_len, "0^");
+						dbuf[i + 1] = 1;
+						i += 1;
+						break;
+					default:
+						do_put(data, max_data_len, data_len, "X");
+						i += 2;
+				}
+				break;
+
+			case 1: // 1
+				switch(dbuf[i + 1]) {
+					case 0:		// 1 0
+						do_put(data, max_data_len, data_len, "1");
+						i += 2;
+						break;
+					case 1:		// 1 1		error no phase change; perhaps missed first symbol
+						do_put(data, max_data_len, data_len, "*");
+						i += 1;
+						break;
+					case 2:		// 1 v		error violation in center; perhaps missed first symbol
+						do_put(data, max_data_len, data_len, "*");
+						i += 1;
+						break;
+					case 3:		// 1 ^		impossible error
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 4:		// 1 0 v
+						do_put(data, max_data_len, data_len, "1v");
+						i += 2;
+						break;
+					case 5:		// 1 1 ^	impossible error
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 6:		// 1 0 v 0
+						do_put(data, max_data_len, data_len, "1v");
+						dbuf[i + 1] = 0;
+						i += 1;
+						break;
+					case 7:		// 1 1 ^ 1	impossible error
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					default:
+						do_put(data, max_data_len, data_len, "X");
+						i += 2;
+				}
+				break;
+
+			case 2: // v
+				do_put(data, max_data_len, data_len, "v");
+				i += 1;
+				break;
+
+			case 3: // ^
+				do_put(data, max_data_len, data_len, "^");
+				i += 1;
+				break;
+
+			case 4: // v 0	-- since first, assuming violation comes before symbol
+				switch(dbuf[i + 1]) {
+					case 0:		// v 0 0	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 1:		// v 0 1
+						do_put(data, max_data_len, data_len, "v0");
+						i += 2;
+						break;
+					case 2:		// v 0 v	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 3:		// v 0 ^	error violation in center
+						do_put(data, max_data_len, data_len, "v*");
+						i += 1;
+						break;
+					case 4:		// v 0 0 v	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 5:		// v 0 1 ^
+						do_put(data, max_data_len, data_len, "v0^");
+						i += 2;
+						break;
+					case 6:		// v 0 0 v 0	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 7:		// v 0 1 ^ 1
+						do_put(data, max_data_len, data_len, "v0^");
+						dbuf[i + 1] = 1;
+						i += 1;
+						break;
+					default:
+						do_put(data, max_data_len, data_len, "X");
+						i += 2;
+				}
+				break;
+
+			case 5: // ^ 1
+				switch(dbuf[i + 1]) {
+					case 0:		// ^ 1 0
+						do_put(data, max_data_len, data_len, "^1");
+						i += 2;
+						break;
+					case 1:		// ^ 1 1	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 2:		// ^ 1 v	error violation in center
+						do_put(data, max_data_len, data_len, "^*");
+						i += 1;
+						break;
+					case 3:		// ^ 1 ^	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 4:		// ^ 1 0 v
+						do_put(data, max_data_len, data_len, "^1v");
+						i += 2;
+						break;
+					case 5:		// ^ 1 1 ^	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 6:		// ^ 1 0 v 0
+						do_put(data, max_data_len, data_len, "^1v");
+						dbuf[i + 1] = 0;
+						i += 1;
+						break;
+					case 7:		// ^ 1 1 ^ 1	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					default:
+						do_put(data, max_data_len, data_len, "X");
+						i += 2;
+				}
+				break;
+
+			case 6: // 0 v 0
+				switch(dbuf[i + 1]) {
+					case 0:		// 0 v 0 0	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 1:		// 0 v 0 1	error violation in center
+						do_put(data, max_data_len, data_len, "*v0");
+						i += 2;
+						break;
+					case 2:		// 0 v 0 v	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 3:		// 0 v 0 ^	error violation in center
+						do_put(data, max_data_len, data_len, "*");
+						i += 1;
+						break;
+					case 4:		// 0 v 0 0 v	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 5:		// 0 v 0 1 v	error violation in center
+						do_put(data, max_data_len, data_len, "*v0v");
+						i += 2;
+						break;
+					case 6:		// 0 v 0 0 v 0	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 7:		// 0 v 0 1 ^ 1	error violation in center
+						do_put(data, max_data_len, data_len, "*v0^");
+						dbuf[i + 1] = 1;
+						i += 1;
+						break;
+					default:
+						do_put(data, max_data_len, data_len, "X");
+						i += 2;
+				}
+				break;
+
+			case 7: // 1 ^ 1
+				switch(dbuf[i + 1]) {
+					case 0:		// 1 ^ 1 0	error violation in center
+						do_put(data, max_data_len, data_len, "*^1");
+						i += 2;
+						break;
+					case 1:		// 1 ^ 1 1 	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 2:		// 1 ^ 1 v	error violation in center
+						do_put(data, max_data_len, data_len, "*");
+						i += 1;
+						break;
+					case 3:		// 1 ^ 1 ^	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 4:		// 1 ^ 1 0 v	error violation in center
+						do_put(data, max_data_len, data_len, "*^1v");
+						i += 2;
+						break;
+					case 5:		// 1 ^ 1 1 ^	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					case 6:		// 1 ^ 1 0 v 0	error violation in center
+						do_put(data, max_data_len, data_len, "*^1v");
+						dbuf[i + 1] = 0;
+						i += 1;
+						break;
+					case 7:		// 1 ^ 1 1 ^ 1	impossible
+						do_put(data, max_data_len, data_len, "#");
+						i += 1;
+						break;
+					default:
+						do_put(data, max_data_len, data_len, "X");
+						i += 2;
+				}
+				break;
+
+			default:
+				do_put(data, max_data_len, data_len, "X");
+				i += 1;
+		}
+	}
+	data[data_len] = 0;
+
+	return data_len;
+}
+
+
+void omnipod_core::decode_compressed() {
+
+	PROFILE_SCOPE(PROFILE_DECODE_COMPRESSED);
+	unsigned int i;
+
+	if(m_show_samples)
+		show_sample();
+	if(m_show_power)
+		do_printf("power: %.1f\t", m_power);
+	for(i = 0; i < m_dbuf_count; i++)
+		switch(m_dbuf[i]) {
+			case 0:
+				do_printf("_");
+				break;
+			case 1:
+				do_printf("-");
+				break;
+			case 2:
+				do_printf("v");
+				break;
+			case 3:
+				do_printf("^");
+				break;
+			case 4:
+				do_printf("_v");
+				break;
+			case 5:
+				do_printf("-^");
+				break;
+			case 6:
+				do_printf("_v_");
+				break;
+			case 7:
+				do_printf("-^-");
+				break;
+			default:
+				do_printf("*");
+		}
+	do_printf("\n");
+
+	// can't tell if this is a "good" signal, so just save it
+	save_signal();
+}
+
+
+void omnipod_core::decode_nrz() {
+
+	PROFILE_SCOPE(PROFILE_DECODE_NRZ);
+	unsigned int i;
+
+	if(m_show_samples)
+		show_sample();
+	if(m_show_power)
+		do_printf("power: %.1f\t", m_power);
+	for(i = 0; i < m_dbuf_count; i++)
+		switch(m_dbuf[i]) {
+			case 0:
+				do_printf("0");
+				break;
+			case 1:
+				do_printf("1");
+				break;
+			case 2:
+				do_printf("v");
+				break;
+			case 3:
+				do_printf("^");
+				break;
+			case 4:
+				do_printf("0v");
+				break;
+			case 5:
+				do_printf("1^");
+				break;
+			case 6:
+				do_printf("0v0");
+				break;
+			case 7:
+				do_printf("1^1");
+				break;
+			default:
+				do_printf("*");
+		}
+	do_printf("\n");
+
+	// can't tell if this is a "good" signal, so just save it
+	save_signal();
+}
+
+
+void omnipod_core::decode_manchester() {
+
+	PROFILE_SCOPE(PROFILE_DECODE_MANCHESTER);
+	unsigned int i, data_len;
+	char *data;
+
+	data_len = manchester(data);
+	if(data_len) {
+		if(m_show_samples)
+			show_sample();
+		if(m_show_power)
+			do_printf("power: %.1f:\t", m_power);
+		if(m_hex) {
+			// display_c_hex_bytes_le(data, data_len);
+			display_c_hex_bytes(data, data_len);
+			do_printf(":\t");
+		}
+
+		int dno = 0;
+		for(i = 0; i < data_len; i++) {
+			if((data[i] == '0') || (data[i] == '1')) {
+				if((dno > 0) && (dno % 4 == 0))
+					do_printf(" ");
+				do_printf("%c", data[i]);
+				dno += 1;
+			} else {
+				do_printf(" %c ", data[i]);
+				dno = 0;
+			}
+		}
+		do_printf("\n");
+
+		// valid signal, save it
+		save_signal();
+	}
+}
+
+
+void omnipod_core::decode_manchester_strict() {
+
+	PROFILE_SCOPE(PROFILE_DECODE_MANCHESTER_STRICT);
+	unsigned int i, start, first, a, b, data_len, errors;
+	unsigned int *error = &m_errors[0];
+	char *data = &m_bits[0], *bits = &m_bits2[0];
+
+	if(find_preamble(start, i) < 0)
+		return;
+
+	data_len = 0;
+	errors = 0;
+	for(first = i; i + 1 < m_dbuf_count; i += 2) {
+		// the preamble's end may carry the first symbol, a high
+		a = (i == first && m_dbuf[i] == 7)? 1 : m_dbuf[i];
+		b = m_dbuf[i + 1];
+
+		// if we have a half-bit symbol anywhere but the start, just finish
+		if((a > 1) || (b > 1))
+			break;
+		if((a == 0) && (b == 1)) {
+			data[data_len++] = 0;
+		} else if((a == 1) && (b == 0)) {
+			data[data_len++] = 1;
+		} else {
+			error[errors++] = i;
+			m_stats.errors_phase += 1;
+		}
+	}
+	if(errors)
+		trigger("decoding error after preamble");
+
+	for(i = 0; i < data_len; i++)
+		bits[i] = '0' + data[i];
+	if(!validate(bits, data_len, errors))
+		return;
+	for(i = 0; i < errors; i++)
+		do_printf("Manchester decoding error: symbol %u\n", error[i]);
+
+	if(data_len) {
+		if(m_show_samples)
+			show_sample();
+		if(m_show_power)
+			do_printf("power: %.1f:\t", m_power);
+		if(m_hex) {
+			display_hex(data, data_len);
+			do_printf(":\t");
+		}
+		for(i = 0; i < data_len; i++)
+			do_printf("%d", data[i]);
+		do_printf("\n");
+
+		// valid signal, save it
+		save_signal();
+	}
+}
+
+
+/*
+ * Find the preamble in m_dbuf.  start is set to its first entry and i to the
+ * first entry of the data after it.  Returns -1 if there is none.
+ */
+int omnipod_core::find_preamble(unsigned int &start, unsigned int &i) {
+
+	static unsigned char preamble[] = {1, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0};
+	static unsigned int preamble_len = sizeof(preamble) / sizeof(*preamble);
+
+	if(m_dbuf_count < preamble_len) {
+		m_stats.preamble_misses += 1;
+		return -1;
+	}
+	for(i = 0; i < m_dbuf_count - preamble_len; i++)
+		if(!memcmp(&m_dbuf[i], preamble, preamble_len))
+			break;;
+	if(i >= m_dbuf_count - preamble_len) {
+		m_stats.preamble_misses += 1;
+		return -1;
+	}
+	start = i;
+
+	/*
+	 * We've identified the preamble except for the
+	 * final half-bit and violation.  1.5-bit symbol.  If this symbol is
+	 * followed by a high, we'll have detected a
+	 * 2.5-bit symbol.  If followed by a low it will
+	 * be a 1.5-bit symbol.
+	 *
+	 * XXX with normal preamble the half-bit symbols
+	 * are high, but other times they can be low.
+	 */
+	i += preamble_len;
+
+	/*
+	 * m_dbuf is left alone, as other representations of the burst may
+	 * follow; a 7 at i stands for its last high.
+	 */
+	if(m_dbuf[i] == 5) {
+		i += 1;		// valid preamble end-symbol followed by low as first symbol of next bit
+	} else if(m_dbuf[i] == 7) {
+		;		// valid preamble end-symbol followed by high as first symbol of next bit
+	} else {
+		do_printf_stdout("preamble was %d\n", m_dbuf[i]);
+		m_stats.preamble_misses += 1;
+		return -1;
+	}
+	m_stats.preamble_hits += 1;
+
+	return 0;
+}
+
+
+/*
+ * Sample in the burst's saved signal where the given number of half-symbols
+ * from its start falls on the grid track_rate() fitted.
+ */
+double omnipod_core::grid(double halves) {
+
+	return m_first_len + m_origin / 65536.0 + (halves - m_first_halves) * m_burst_sps / 131072.0;
+}
+
+
+/*
+ * Mean envelope over [from, to) of m_soft.  The sum runs in four lanes, which
+ * the compiler may not do itself since it changes the rounding.
+ */
+float omnipod_core::window(double from, double to) {
+
+	unsigned int i, a = (unsigned int)lrint(from), b = (unsigned int)lrint(to);
+	const float *env = &m_soft[0];
+	float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+	if(b > m_soft.size())
+		b = m_soft.size();
+	if(b <= a)
+		return 0;
+	for(i = a; i + 4 <= b; i += 4) {
+		s0 += env[i];
+		s1 += env[i + 1];
+		s2 += env[i + 2];
+		s3 += env[i + 3];
+	}
+	for(; i < b; i++)
+		s0 += env[i];
+	return ((s0 + s1) + (s2 + s3)) / (b - a);
+}
+
+
+/*
+ * Soft-decision Manchester.  The preamble is found in the sliced symbols as
+ * for REP_MANCHESTER_STRICT, but the data after it is taken from the burst's
+ * saved samples: the envelope is integrated over each symbol on the grid
+ * track_rate() fitted, and each bit is decided by which of its two symbols
+ * had more.  A symbol the slicer got wrong costs one uncertain bit rather
+ * than the rest of the burst.  Each bit's confidence, 0 to 9, is the
+ * difference between its symbols as a fraction of the difference between
+ * the high and low levels of the preamble.  The data ends when neither
+ * symbol of a bit is high.
+ */
+void omnipod_core::decode_soft() {
+
+	PROFILE_SCOPE(PROFILE_DECODE_SOFT);
+	static const int level[] = {1, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 0};
+	static const unsigned int level_len = sizeof(level) / sizeof(*level);
+	static const unsigned char halves[] = {2, 2, 1, 1, 3, 3, 5, 5};
+
+	unsigned int i, j, n, start, nitems, data_len, guesses;
+	double h, trim = m_sps / 8.0, a, b, high = 0, low = 0, conf;
+	omnipod_complex cbuf[512];
+	char *data = &m_bits[0], *confidence = &m_bits2[0];
+	char *buf;
+
+	if(find_preamble(start, i) < 0)
+		return;
+
+	// envelope of the saved samples
+	buf = signal_samples(&nitems);
+	m_soft.resize(nitems);
+	for(i = 0; i < nitems; i += n) {
+		n = signal_to_complex(buf + i * m_item_size, nitems - i, cbuf, sizeof(cbuf) / sizeof(*cbuf));
+		for(j = 0; j < n; j++)
+			m_soft[i + j] = sqrt(cbuf[j].real() * cbuf[j].real() + cbuf[j].imag() * cbuf[j].imag());
+	}
+
+	// the preamble's levels; symbols are trimmed at each end for timing error
+	for(h = 0, j = 0; j < start; j++)
+		h += halves[m_dbuf[j]];
+	for(j = 0; j < level_len; j++, h += 2) {
+		if(level[j])
+			high += window(grid(h) + trim, grid(h + 2) - trim);
+		else
+			low += window(grid(h) + trim, grid(h + 2) - trim);
+	}
+	high /= 7;
+	low /= 7;
+	if(high <= low)
+		return;
+
+	// past the 1.5-symbol high that ends the preamble
+	h += 3;
+	for(data_len = 0; data_len < m_bits.size() - 1 && grid(h + 4) <= nitems; data_len++, h += 4) {
+		a = window(grid(h) + trim, grid(h + 2) - trim);
+		b = window(grid(h + 2) + trim, grid(h + 4) - trim);
+		if(a < (high + low) / 2 && b < (high + low) / 2)
+			break;
+		data[data_len] = (a > b)? '1' : '0';
+		conf = fabs(a - b) / (high - low);
+		confidence[data_len] = '0' + ((conf < 0.95)? (int)(conf * 10 + 0.5) : 9);
+	}
+	data[data_len] = 0;
+	confidence[data_len] = 0;
+
+	// a bit of confidence 0 is as good as a decoding error
+	for(guesses = 0, i = 0; i < data_len; i++)
+		if(confidence[i] == '0')
+			guesses += 1;
+	if(!validate(data, data_len, guesses))
+		return;
+
+	if(data_len) {
+		if(m_show_samples)
+			show_sample();
+		if(m_show_power)
+			do_printf("power: %.1f:\t", m_power);
+		if(m_hex) {
+			display_c_hex(data, data_len);
+			do_printf(":\t");
+		}
+		do_printf("%s\n%s\n", data, confidence);
+
+		// valid signal, save it
+		save_signal();
+	}
+}
+
+
+
+/*
+ * The symbols after the preamble through a line_decoder.  The data runs to
+ * the first symbol of other than a whole symbol's width.  The preamble ends
+ * high, which is the symbol before the first.
+ */
+void omnipod_core::decode_line(line_decoder *d) {
+
+	PROFILE_SCOPE(PROFILE_DECODE_LINE);
+	unsigned int i, start, nsymbols, data_len, errors;
+	unsigned char *symbols = &m_dcopy[0];
+	char *data = &m_bits[0];
+
+	if(find_preamble(start, i) < 0)
+		return;
+
+	nsymbols = 0;
+	if(m_dbuf[i] == 7) {
+		symbols[nsymbols++] = 1;
+		i += 1;
+	}
+	for(; i < m_dbuf_count && m_dbuf[i] <= 1; i++)
+		symbols[nsymbols++] = m_dbuf[i];
+
+	data_len = d->decode(symbols, nsymbols, 1, data, m_bits.size() - 1);
+	data[data_len] = 0;
+	count_errors(data, data_len);
+	for(errors = 0, i = 0; i < data_len; i++)
+		if(data[i] == 'X')
+			errors += 1;
+	if(errors)
+		trigger("decoding error after preamble");
+	if(!validate(data, data_len, errors))
+		return;
+
+	if(data_len) {
+		if(m_show_samples)
+			show_sample();
+		if(m_show_power)
+			do_printf("power: %.1f:\t", m_power);
+		if(m_hex) {
+			display_c_hex(data, data_len);
+			do_printf(":\t");
+		}
+		do_printf("%s\n", data);
+
+		// valid signal, save it
+		save_signal();
+	}
+}
+
+int bits_to_uchar(char *data, const unsigned int max_data_len, char *&p, unsigned int bits, unsigned char &c) {
+
+	unsigned int i;
+
+	c = 0;
+	if(bits > 8)
+		bits = 8;
+	for(i = 0; ((p - data) < max_data_len) && (i < bits) && ((*p == '0') || (*p == '1')); i++)
+		c = (c << 1) | (*p++ - '0');
+	if(i >= bits)
+		return 0;
+	if(p - data >= max_data_len)
+		return -1;
+	p += (bits - i);
+	return bits - i;
+}
+
+
+int bits_to_uint(char *data, const unsigned int max_data_len, char *&p, unsigned int bits, unsigned int &u) {
+
+	unsigned int i;
+
+	u = 0;
+	if(bits > 32)
+		bits = 32;
+	for(i = 0; ((p - data) < max_data_len) && (i < bits) && ((*p == '0') || (*p == '1')); i++)
+		u = (u << 1) | (*p++ - '0');
+	if(i >= bits)
+		return 0;
+	if(p - data >= max_data_len)
+		return -1;
+	p += (bits - i);
+	return bits - i;
+}
+
+
+void omnipod_core::decode_protocol() {
+
+	PROFILE_SCOPE(PROFILE_DECODE_PROTOCOL);
+	static const char *preamble = "1101111110^";
+	static const unsigned int preamble_len = strlen(preamble);
+
+	int r;
+	unsigned int i, data_len, u, nbits, markers;
+	char *bits = &m_bits[0], *data, *p;
+
+	data_len = manchester(data);
+	if(!data_len)
+		return;
+
+	// valid signal, save it; with frame checks, only once it has passed them
+	if(!m_frame.enabled())
+		save_signal();
+
+	if(!(p = strstr(data, preamble))) {
+		m_stats.preamble_misses += 1;
+		return;
+	}
+	m_stats.preamble_hits += 1;
+	if(strpbrk(p, "*#X"))
+		trigger("decoding error after preamble");
+
+	for(nbits = 0, markers = 0, i = preamble_len; p[i]; i++) {
+		if(p[i] == '0' || p[i] == '1')
+			bits[nbits++] = p[i];
+		else if(strchr("*#X", p[i]))
+			markers += 1;
+	}
+	if(!validate(bits, nbits, markers))
+		return;
+	if(m_frame.enabled())
+		save_signal();
+	if(m_messages.enabled() && !markers && !m_invalid && !m_sink)
+		m_frame_bits.assign(bits, nbits);
+
+	if(m_show_samples)
+		show_sample();
+
+	if(m_show_power)
+		do_printf("power: %.1f:\t", m_power);
+
+	// first find preamble
+	do_printf("P:");
+	p += preamble_len;
+
+	// bit 0: expect more bursts
+	if((r = bits_to_uint(data, data_len, p, 1, u))) {
+		if(r < 0) {
+			do_printf("\n");
+			return;
+		}
+		do_printf(" X");
+	} else
+		do_printf(" %x", u);
+
+	// bits 1 - 2: message type (?)
+	if((r = bits_to_uint(data, data_len, p, 2, u))) {
+		if(r < 0) {
+			do_printf("\n");
+			return;
+		}
+		do_printf(" X");
+	} else
+		do_printf(" %x", u);
+
+	// bits 3 - 7: sequence number
+	if((r = bits_to_uint(data, data_len, p, 5, u))) {
+		if(r < 0) {
+			do_printf("\n");
+			return;
+		}
+		do_printf(" XX");
+	} else
+		do_printf(" %2.2x", u);
+
+	// 4 unsigned int
+	for(i = 0; i < 4; i++) {
+		if((r = bits_to_uint(data, data_len, p, 32, u))) {
+			if(r < 0) {
+				do_printf("\n");
+				return;
+			}
+			do_printf(" XXXXXXXX");
+		} else
+			do_printf(" %8.8x", u);
+	}
+
+	// unsigned short
+	if((r = bits_to_uint(data, data_len, p, 16, u))) {
+		if(r < 0) {
+			do_printf("\n");
+			return;
+		}
+		do_printf(" XXXX");
+	} else
+		do_printf(" %4.4x", u);
+
+	// 4 4-bit
+	for(i = 0; i < 4; i++) {
+		if((r = bits_to_uint(data, data_len, p, 4, u))) {
+			if(r < 0) {
+				do_printf("\n");
+				return;
+			}
+			do_printf(" X");
+		} else
+			do_printf(" %x", u);
+	}
+
+	// done
+	do_printf(" !\n");
+}
+
+
+/*
+ * manchester_decode() of the burst, done once however many representations
+ * ask for it.  It rewrites the symbols it is given, so it gets a copy.
+ */
+unsigned int omnipod_core::manchester(char *&data) {
+
+	if(m_data_len < 0) {
+		memcpy(&m_dcopy[0], &m_dbuf[0], m_dbuf_count);
+		m_data_len = manchester_decode(&m_dcopy[0], m_dbuf_count, &m_data[0], m_data.size());
+		count_errors(&m_data[0], m_data_len);
+	}
+	data = &m_data[0];
+	return m_data_len;
+}
+
+
+void omnipod_core::decode(int rep) {
+
+	switch(rep) {
+
+		/*
+		 * Note: in compressed and NRZ we assume that a
+		 * violation symbol is always transmitted as following
+		 * a valid symbol or between valid symbols.
+		 */
+
+		/*
+		 * Display signal in "compressed" form.
+		 */
+		case REP_COMPRESSED:
+			decode_compressed();
+			break;
+
+		/*
+		 * Display the signal as NRZ.
+		 */
+		case REP_NRZ:
+			decode_nrz();
+			break;
+
+		/*
+		 * Manchester decode without regard for preamble.
+		 */
+		case REP_MANCHESTER:
+			decode_manchester();
+			break;
+
+		/*
+		 * Manchester decode the bits following the preamble.
+		 */
+		case REP_MANCHESTER_STRICT:
+			decode_manchester_strict();
+			break;
+
+		case REP_DECODE:
+			decode_protocol();
+			break;
+
+		/*
+		 * Manchester decode the bits following the preamble from
+		 * the samples rather than the slicer.
+		 */
+		case REP_SOFT:
+			decode_soft();
+			break;
+
+		/*
+		 * Other line codings of the bits following the preamble.
+		 */
+		case REP_FM0:
+			decode_line(line_decoder::find("fm0"));
+			break;
+
+		case REP_DIFF_MANCHESTER:
+			decode_line(line_decoder::find("differential"));
+			break;
+
+		case REP_8B10B:
+			decode_line(line_decoder::find("8b10b"));
+			break;
+
+		default:
+			do_printf("unknown representation\n");
+	}
+}
+
+
+void omnipod_core::represent() {
+
+	PROFILE_SCOPE(PROFILE_REPRESENT);
+	unsigned long long hash = 0;
+	int repeated = 0;
+	omnipod_stats stats;
+	double start = now(), end;
+
+	m_write_time = 0;
+	m_output = 0;
+	m_frame_bits.clear();
+
+	// levels of the burst, as the slicer went over it
+	m_levels.mean = m_burst_n? m_burst_sum / m_burst_n : 0;
+	m_levels.peak = m_burst_peak;
+	m_levels.high = m_high_n? m_high_sum / m_high_n : 0;
+	m_levels.low = m_low_n? m_low_sum / m_low_n : 0;
+	m_levels.noise = (m_noise > 0)? m_noise : 0;
+	m_levels.snr = (m_levels.high > 0 && m_levels.noise > 0)? 20 * log10(m_levels.high / m_levels.noise) : 0;
+	m_power = m_levels.mean;
+
+	m_nbursts += 1;
+	m_stats.bursts_finished += 1;
+	m_stats.buffer_grows = m_dbuf_grows;
+	m_trace.add(TRACE_BURST_END, m_sample_number, threshold_level(), m_dbuf_count, 0, 0);
+
+	/*
+	 * A recorded burst is decoded anyway and looked for when it is
+	 * emitted, so the output does not depend on how the input was
+	 * split up.
+	 */
+	if(m_repeats.enabled())
+		hash = burst_cache::hash(&m_dbuf[0], m_dbuf_count);
+
+	if(m_record) {
+		m_bursts.push_back(omnipod_burst());
+		m_burst = &m_bursts.back();
+		m_burst->start = m_signal_start;
+		m_burst->save = 0;
+		m_burst->invalid = 0;
+		m_burst->hash = hash;
+		m_burst->levels = m_levels;
+	} else {
+		// messages given up on come before this burst, as in emit()
+		if(m_messages.pending())
+			expire_messages(m_signal_start);
+		if(hash)
+			repeated = repeat(hash);
+	}
+
+	m_data_len = -1;
+	if(!repeated) {
+		decode(m_rep);
+
+		// the counters are for the main representation only
+		if(m_sinks.size()) {
+			stats = m_stats;
+			for(m_sink = 1; m_sink <= (int)m_sinks.size(); m_sink++)
+				decode(m_sinks[m_sink - 1].rep);
+			m_sink = 0;
+			m_stats = stats;
+		}
+	}
+
+	if(hash && !m_record && !repeated)
+		remember(hash);
+
+	// after the burst's own line
+	if(m_burst)
+		m_burst->frame.swap(m_frame_bits);
+	else if(m_frame_bits.size())
+		assemble(m_frame_bits);
+
+	m_burst = 0;
+	m_invalid = 0;
+
+	end = now();
+	m_stats.represent_time += end - start;
+	if(m_output) {
+		m_latency[LATENCY_TOTAL].add(end - m_symbol_time);
+		m_latency[LATENCY_WAIT].add(start - m_symbol_time);
+		m_latency[LATENCY_DECODE].add(end - start - m_write_time);
+		m_latency[LATENCY_WRITE].add(m_write_time);
+	}
+}
+
+
+void omnipod_core::slice() {
+
+	PROFILE_SCOPE(PROFILE_SLICE);
+	unsigned int i, j;
+	double symbols;
+	unsigned long long first;
+
+	m_stats.transitions += 1;
+
+	// a new burst starts on the nominal rate
+	if(!m_dbuf_count) {
+		m_burst_sps = m_sps_q16;
+		m_phase = 0;
+		m_edges = 0;
+		m_anchored = 0;
+
+		// and, if this high run is where a hit put the preamble, from there
+		first = m_saved - (m_count + m_jitter + 1);
+		if(m_seed && m_sign > 0 && m_saved >= m_count + m_jitter + 1 && first >= m_seed_first && first - m_seed_first <= m_sps / 2) {
+			m_anchored = 1;
+			m_anchor_lead = first - m_seed_first;
+			m_anchor_late = m_anchor_lead - m_seed_offset;
+			m_phase = (int)lrint(m_anchor_late * 65536);
+		}
+	}
+
+	// width on this burst's symbol grid, less how late the last edge was
+	symbols = (((double)m_count * 65536) + m_phase) / m_burst_sps;
+
+
+	// we can detect at most m_avg_n - 1 sequential values
+	for(i = 1; (i < m_avg_n - 1) && ((double)i - m_error < symbols); i++) {
+		if(symbols <= ((double)i + m_error)) {
+			// valid symbol
+
+			// if first valid symbol in burst, save start
+			if(!m_dbuf_count)
+				start_burst();
+
+			// the valid samples stay where they are in m_cb
+			extend_signal(m_saved - (m_jitter + 1));
+			m_stats.runs[i] += 1;
+			add_run();
+			m_symbol_time = m_work_time;
+			track_rate(2 * i);
+			m_trace.add(TRACE_RUN, m_sample_number, threshold_level(), m_count, 2 * i, m_sign > 0);
+
+			for(j = 0; j < i; j++) {
+				// if demodulated buffer is full and may not grow, display it
+				if(m_dbuf_count >= m_dbuf.size() && fit_burst(m_dbuf_count + 1) < 0) {
+					m_stats.bursts_truncated += 1;
+					represent();
+					m_dbuf_count = 0;
+				}
+				m_dbuf[m_dbuf_count++] = (m_sign >= 0);
+			}
+
+			return;
+		}
+	}
+
+	/*
+	 * Half-symbol logic guesses:
+	 *
+	 * A half-symbol indicates a violation and usually separates the
+	 * preamble and data.
+	 *
+	 * A half-symbol never occurs in the center of a bit.  (I.e.,
+	 * between two symbols that represent a bit.)
+	 *
+	 * I'd like to assume that a violation always continues the last
+	 * transmitted symbol, but I'm not positive.
+	 *
+	 * Only .5, 1.5, and 2.5 widths could possibly be transmitted
+	 * normally for otherwise a bit was transmitted without a phase
+	 * transition.
+	 */
+
+	// detect half-symbols
+	for(i = 0; (i <= 2) && ((double)i + 0.5 - m_error < symbols); i++) {
+		if(symbols <= ((double)i + 0.5 + m_error)) {
+			// valid half-symbols
+
+			// if first valid symbol in burst, save start
+			if(!m_dbuf_count)
+				start_burst();
+
+			// the valid samples stay where they are in m_cb
+			extend_signal(m_saved - (m_jitter + 1));
+			m_stats.half_runs[i] += 1;
+			add_run();
+			m_symbol_time = m_work_time;
+			track_rate(2 * i + 1);
+			m_trace.add(TRACE_RUN, m_sample_number, threshold_level(), m_count, 2 * i + 1, m_sign > 0);
+
+			if(m_dbuf_count >= m_dbuf.size() && fit_burst(m_dbuf_count + 1) < 0) {
+				m_stats.bursts_truncated += 1;
+				represent();
+				m_dbuf_count = 0;
+			}
+			m_dbuf[m_dbuf_count++] = (i + 1) * 2 + (m_sign >= 0);
+
+			return;
+		}
+	}
+
+	// this width did not match valid symbols
+	m_stats.rejected += 1;
+	m_trace.add(TRACE_RUN, m_sample_number, threshold_level(), m_count, -1, m_sign > 0);
+	if(m_sign < 0)
+		track_noise();
+	if(m_dbuf_count > 0)
+		end_burst(m_count + m_jitter + 1, m_count + m_jitter);
+
+	return;
+}
+
+
+/*
+ * The run slice() is accepting is the first of a burst, which starts with it
+ * or, if the burst is anchored, on the sample the hit starts on.
+ */
+void omnipod_core::start_burst() {
+
+	unsigned int back = m_count + m_jitter + 1;
+
+	if(m_anchored)
+		back += m_anchor_lead;
+	m_last_signal_start = m_signal_start;
+	m_signal_start = m_sample_number - (back + m_delay);
+	m_signal_first = (m_saved > back)? m_saved - back : 0;
+	m_signal_len = 0;
+	m_seed = 0;
+	m_stats.bursts_started += 1;
+	m_trace.add(TRACE_BURST_START, m_signal_start, threshold_level(), 0, 0, 0);
+}
+
+
+/*
+ * Makes room for len symbols in m_dbuf, and in the decoders' buffers that go
+ * with it, doubling them as far as set_max_burst() allows.  They are not
+ * shrunk again.  Returns -1 if len is over that.
+ */
+int omnipod_core::fit_burst(unsigned int len) {
+
+	unsigned int n;
+
+	if(len <= m_dbuf.size())
+		return 0;
+	if(len > m_max_symbols)
+		return -1;
+	for(n = m_dbuf.size()? m_dbuf.size() : len; n < len; n = (n > m_max_symbols / 2)? m_max_symbols : 2 * n)
+		;
+	if(m_dbuf.size())
+		m_dbuf_grows += 1;
+	m_dbuf.resize(n);
+	m_dcopy.resize(n);
+	m_data.resize(2 * n);
+	m_bits.resize(2 * n);
+	m_bits2.resize(2 * n);
+	m_errors.resize(n);
+	return 0;
+}
+
+
+/*
+ * Adds the run slice() has just accepted to the burst's levels.
+ */
+void omnipod_core::add_run() {
+
+	if(!m_dbuf_count) {
+		m_burst_sum = m_high_sum = m_low_sum = 0;
+		m_burst_n = m_high_n = m_low_n = 0;
+		m_burst_peak = 0;
+	}
+	m_burst_sum += m_run_sum;
+	m_burst_n += m_count;
+	if(m_run_peak > m_burst_peak)
+		m_burst_peak = m_run_peak;
+	if(m_sign > 0) {
+		m_high_sum += m_run_sum;
+		m_high_n += m_count;
+	} else {
+		m_low_sum += m_run_sum;
+		m_low_n += m_count;
+	}
+}
+
+
+/*
+ * A low too long to be a symbol is the channel idle.  The noise floor is the
+ * mean envelope over the last m_noise_len or so samples of them.
+ */
+void omnipod_core::track_noise() {
+
+	double mean;
+
+	if(!m_count)
+		return;
+	mean = m_run_sum / m_count;
+	if(m_noise < 0)
+		m_noise = mean;
+	else
+		m_noise += (mean - m_noise) * m_count / (m_count + m_noise_len);
+}
+
+
+/*
+ * Finish the burst at a run that is not a symbol.  The run started back
+ * samples before the end of m_cb and len samples of it are kept.
+ */
+void omnipod_core::end_burst(unsigned int back, unsigned int len) {
+
+	unsigned int max = 8 * m_average_len;
+
+	/*
+	 * Since we have valid data and this is the first place
+	 * we errored out, we want to preserve this data as
+	 * well.  There could be a lot of junk data here so we
+	 * limit the amount.
+	 */
+	if(len < max)
+		max = len;
+	extend_signal(m_saved - back + max);
+
+	// display the buffer
+	represent();
+	m_dbuf_count = 0;
+}
+
+
+/*
+ * The burst's samples run on to end, an m_saved count, as far as
+ * m_max_signal.  Past that they are not kept, though the burst goes on.
+ */
+void omnipod_core::extend_signal(unsigned long long end) {
+
+	if(end > m_signal_first + m_max_signal)
+		end = m_signal_first + m_max_signal;
+	if(end > m_signal_first + m_signal_len)
+		m_signal_len = end - m_signal_first;
+}
+
+
+/*
+ * The burst's samples, in place in m_cb.  They are good until the slicer
+ * next runs, which is as long as represent() needs them; the mirrored
+ * mapping keeps them contiguous across the wrap.
+ */
+char *omnipod_core::signal_samples(unsigned int *nitems) {
+
+	unsigned long long first = m_signal_first, oldest;
+	unsigned int avail, skip = 0;
+	char *buf;
+
+	buf = (char *)m_cb->peek(&avail);
+	oldest = m_saved - avail;
+
+	// extend_run() ends a burst before this can happen
+	if(first < oldest) {
+		skip = oldest - first;
+		first = oldest;
+	}
+	*nitems = (m_signal_len > skip)? m_signal_len - skip : 0;
+	return buf + (first - oldest) * m_item_size;
+}
+
+
+// every sample goes through m_cb, counted so bursts can point into it
+inline void omnipod_core::save_sample(const void *item) {
+
+	m_cb->write(item, 1);
+	m_saved += 1;
+}
+
+
+/*
+ * Timing recovery.  The start of a burst is where the threshold is least
+ * settled, so the end of its first run anchors a grid of half-symbols.  Each
+ * later edge is a point (half-symbols, samples) since then; a least squares
+ * line through them gives the burst's rate, from the preamble at first and
+ * refined over the rest of the burst, and m_phase is how far the last edge
+ * lies off that line.  A run's width is measured from where the line puts its
+ * start, so neither rounding nor clock error add up over a burst.  A burst
+ * anchored on a preamble_hit has one more point, the preamble's start as the
+ * matched filter timed it to a fraction of a sample; until the rate is fitted
+ * the line runs from there at the nominal rate.
+ */
+void omnipod_core::track_rate(unsigned int halves) {
+
+	double n, d, slope, icept, sum_t, sum_h, sum_hh, sum_ht;
+
+	if(!m_edges++) {
+		m_edge_t = 0;
+		m_edge_h = 0;
+		m_sum_t = m_sum_h = m_sum_hh = m_sum_ht = 0;
+		m_phase = 0;
+		m_origin = 0;
+		m_first_len = m_count;
+		m_first_halves = halves;
+		if(m_anchored) {
+			// the grid starts where the hit put the preamble
+			m_first_len += m_anchor_lead;
+			m_anchor_t = -(m_count + m_anchor_late);
+			m_anchor_h = -(long long)halves;
+			m_origin = (int)lrint((m_anchor_t - m_anchor_h * m_burst_sps / 131072.0) * 65536);
+			m_phase = -m_origin;
+		}
+		return;
+	}
+
+	m_edge_t += m_count;
+	m_edge_h += halves;
+	m_sum_t += m_edge_t;
+	m_sum_h += m_edge_h;
+	m_sum_hh += m_edge_h * m_edge_h;
+	m_sum_ht += m_edge_h * m_edge_t;
+
+	n = m_edges;
+	sum_t = m_sum_t;
+	sum_h = m_sum_h;
+	sum_hh = m_sum_hh;
+	sum_ht = m_sum_ht;
+	if(m_anchored) {
+		// not a fixed point: a clock error moves the filter's peak by up to a sample
+		n += 1;
+		sum_t += m_anchor_t;
+		sum_h += m_anchor_h;
+		sum_hh += (double)m_anchor_h * m_anchor_h;
+		sum_ht += m_anchor_h * m_anchor_t;
+	}
+	d = n * sum_hh - sum_h * sum_h;
+	if(m_edge_h < m_rate_halves || d <= 0) {
+		if(m_anchored)
+			m_phase = (int)lrint((m_edge_t - m_anchor_t - (m_edge_h - m_anchor_h) * m_burst_sps / 131072.0) * 65536);
+		else
+			m_phase = (int)(m_edge_t * 65536 - m_edge_h * m_burst_sps / 2);
+		return;
+	}
+
+	slope = 2 * (n * sum_ht - sum_h * sum_t) / d;
+	if(slope > m_sps_q16 / 65536.0 * (1 + m_max_drift))
+		slope = m_sps_q16 / 65536.0 * (1 + m_max_drift);
+	if(slope < m_sps_q16 / 65536.0 * (1 - m_max_drift))
+		slope = m_sps_q16 / 65536.0 * (1 - m_max_drift);
+	icept = (sum_t - slope / 2 * sum_h) / n;
+
+	m_burst_sps = (unsigned int)lrint(slope * 65536);
+	m_phase = (int)lrint((m_edge_t - icept - slope / 2 * m_edge_h) * 65536);
+	m_origin = (int)lrint(icept * 65536);
+}
+
+
+/*
+ * Hysteresis on the slicer decision: the envelope must stay on the other side
+ * of the threshold for m_jitter samples before the run is handed to slice().
+ * A run reaching m_burst_timeout ends the burst without waiting for that.
+ * level is the sample's envelope in input units, summed over each run for
+ * the burst's levels.
+ */
+void omnipod_core::decide(int high, float level) {
+
+	PROFILE_SCOPE(PROFILE_DECIDE);
+
+	if(!high) {
+		if(m_sign < 0) {
+			extend_run(level);
+		} else {
+			// swapped from high to low
+			if(m_change_count < m_jitter) {
+				hold_run(level);
+			} else {
+				slice();
+				m_sign = -1;
+				next_run(level);
+			}
+		}
+	} else {
+		if(m_sign > 0) {
+			extend_run(level);
+		} else {
+			// swapped from low to high
+			if(m_change_count < m_jitter) {
+				hold_run(level);
+			} else {
+				slice();
+				m_sign = 1;
+				next_run(level);
+			}
+		}
+	}
+}
+
+
+/*
+ * The sample continues the run, with any that had looked like the start of
+ * the next one.
+ */
+inline void omnipod_core::extend_run(float level) {
+
+	m_count += m_change_count + 1;
+	m_change_count = 0;
+	m_run_sum += m_change_sum + level;
+	m_change_sum = 0;
+	if(m_change_peak > m_run_peak)
+		m_run_peak = m_change_peak;
+	if(level > m_run_peak)
+		m_run_peak = level;
+	m_change_peak = 0;
+
+	// or before m_cb overwrites the burst's first sample
+	if(m_dbuf_count && (m_count >= m_burst_timeout || m_saved - m_signal_first >= m_pin_len)) {
+		if(m_count >= m_burst_timeout)
+			m_stats.bursts_timed_out += 1;
+		else if(m_signal_len >= m_max_signal)
+			m_stats.bursts_truncated += 1;
+		end_burst(m_count, m_count);
+	}
+}
+
+
+// the sample is on the other side, but not yet for long enough
+inline void omnipod_core::hold_run(float level) {
+
+	m_change_count += 1;
+	m_change_sum += level;
+	if(level > m_change_peak)
+		m_change_peak = level;
+}
+
+
+// the held samples and this one start the next run
+inline void omnipod_core::next_run(float level) {
+
+	m_count = m_change_count + 1;
+	m_change_count = 0;
+	m_run_sum = m_change_sum + level;
+	m_run_peak = (level > m_change_peak)? level : m_change_peak;
+	m_change_sum = 0;
+	m_change_peak = 0;
+}
+
+
+/*
+ * Alpha max plus beta min magnitude approximation with alpha = 123/128 and
+ * beta = 51/128.  The result is scaled by 128 and is within 4% of the true
+ * magnitude.
+ */
+static inline int imag_approx(const short *s) {
+
+	int i = s[0], q = s[1];
+
+	if(i < 0)
+		i = -i;
+	if(q < 0)
+		q = -q;
+	if(i > q)
+		return 123 * i + 51 * q;
+	return 123 * q + 51 * i;
+}
+
+
+/*
+ * Fixed-point version of the work() loop for interleaved 16-bit I/Q.
+ *
+ * Both the current sample and the running sums use the same magnitude
+ * approximation, so most of its error cancels in the comparison.  A slicing
+ * decision can only differ from the float path when the sample is within the
+ * approximation error (4%) of the threshold, and the m_jitter hysteresis
+ * absorbs isolated flips of that kind.
+ */
+int omnipod_core::work_short(const short *ins, unsigned int nitems) {
+
+	PROFILE_SCOPE(PROFILE_ENVELOPE);
+	unsigned int i, j;
+	long long cur, sum;
+
+
+	for(i = 0; i + 2 * m_average_len + 1 < nitems; i++) {
+
+		// save input signal; the sample being decided, not the oldest in the window
+		save_sample(&ins[2 * (i + m_average_len + 1)]);
+
+		// pre-compute initial average
+		if(m_starting) {
+			m_iaverage_a = 0;
+			m_iaverage_b = 0;
+			for(j = 0; j < m_average_len; j++) {
+				m_iaverage_a += imag_approx(&ins[2 * (m_average_len + 1 + j)]);
+				m_iaverage_b += imag_approx(&ins[2 * j]);
+			}
+			m_sample_number = m_sample_base + m_average_len;
+			m_starting = 0;
+		}
+
+		m_sample_number += 1;
+
+		// running sums
+		cur = imag_approx(&ins[2 * (i + m_average_len + 1)]);
+		m_iaverage_a = m_iaverage_a - cur + imag_approx(&ins[2 * (i + 2 * m_average_len + 1)]);
+		m_iaverage_b = m_iaverage_b - imag_approx(&ins[2 * i]) + imag_approx(&ins[2 * (i + m_average_len)]);
+
+		// see work() for the choice of average
+		if(m_dbuf_count <= 2 * m_avg_n) {
+			sum = m_iaverage_a;
+		} else {
+			sum = m_iaverage_b;
+		}
+
+		// cur < sum / m_average_len without the division
+		decide(cur * m_average_len >= sum, cur / 128.0f);
+	}
+
+	return i;
+}
+
+
+/*
+ * Envelope follower.  Each level moves quickly towards samples beyond it and
+ * slowly back otherwise.  The threshold is halfway between the two, so it
+ * needs no samples after the current one.
+ */
+double omnipod_core::track(double cur) {
+
+	if(cur > m_high)
+		m_high += m_attack * (cur - m_high);
+	else
+		m_high += m_decay * (cur - m_high);
+
+	if(cur < m_low)
+		m_low += m_attack * (cur - m_low);
+	else
+		m_low += m_decay * (cur - m_low);
+
+	return (m_high + m_low) / 2;
+}
+
+
+/*
+ * work() loop for THRESHOLD_TRACKER.  There is no look-ahead so the
+ * current sample is the newest one and every input item is consumed.
+ */
+int omnipod_core::work_tracker(const void *in, unsigned int nitems) {
+
+	PROFILE_SCOPE(PROFILE_ENVELOPE);
+	const omnipod_complex *inc = (const omnipod_complex *)in;
+	const short *ins = (const short *)in;
+	unsigned int i;
+	double cur;
+
+
+	for(i = 0; i < nitems; i++) {
+
+		// save input signal
+		if(m_short_input) {
+			save_sample(&ins[2 * i]);
+			cur = imag_approx(&ins[2 * i]);
+		} else {
+			save_sample(&inc[i]);
+			cur = std::abs(inc[i]);
+		}
+
+		m_sample_number += 1;
+
+		decide(!(cur < track(cur)), m_short_input? cur / 128 : cur);
+	}
+
+	return i;
+}
+
+
+/*
+ * work() loop for THRESHOLD_MATCHED.  Items wait in m_pending until the
+ * detector has scored every preamble that could start at them.  Between
+ * bursts everything is low; at a preamble the threshold is set halfway
+ * between the levels the detector measured and held until the signal has
+ * been low for longer than any symbol.  Every input item is consumed.
+ */
+int omnipod_core::work_matched(const void *in, unsigned int nitems) {
+
+	PROFILE_SCOPE(PROFILE_ENVELOPE);
+	const omnipod_complex *inc = (const omnipod_complex *)in;
+	const short *ins = (const short *)in;
+	unsigned int i, h;
+	unsigned long long ready;
+	float cur;
+
+
+	for(i = 0; i < nitems; i++) {
+		if(m_short_input)
+			m_env.push_back(imag_approx(&ins[2 * i]) / 128.0f);
+		else
+			m_env.push_back(std::abs(inc[i]));
+	}
+	m_pending.insert(m_pending.end(), (const char *)in, (const char *)in + nitems * m_item_size);
+	m_detector->process(&m_env[m_env.size() - nitems], nitems, m_hits);
+
+	ready = m_detector->ready();
+	for(i = 0, h = 0; m_sliced < ready; i++, m_sliced++) {
+
+		// save input signal
+		save_sample(&m_pending[i * m_item_size]);
+
+		m_sample_number += 1;
+		cur = m_env[i];
+
+		/*
+		 * Hits inside a burst are its data looking like a preamble,
+		 * unless the burst has already been quiet for longer than
+		 * Manchester data ever is; then a short gap is all that
+		 * separates it from the next one.
+		 */
+		for(; h < m_hits.size() && m_hits[h].start <= m_sliced; h++) {
+			if(m_hits[h].start == m_sliced && (m_burst_threshold == HUGE_VAL || m_below > 2 * m_sps)) {
+				m_burst_threshold = (m_hits[h].high + m_hits[h].low) / 2;
+				m_below = 0;
+
+				// and times the burst that follows
+				m_seed = 1;
+				m_seed_first = m_saved - 1;
+				m_seed_offset = m_hits[h].offset;
+			}
+		}
+
+		if(cur < m_burst_threshold) {
+			if(m_burst_threshold != HUGE_VAL && ++m_below > m_avg_n * m_sps)
+				m_burst_threshold = HUGE_VAL;
+
+			// idle; don't let the run count wrap
+			if(m_burst_threshold == HUGE_VAL && m_sign < 0 && m_count >= (1U << 30))
+				continue;
+		} else
+			m_below = 0;
+
+		decide(!(cur < m_burst_threshold), cur);
+	}
+
+	m_env.erase(m_env.begin(), m_env.begin() + i);
+	m_pending.erase(m_pending.begin(), m_pending.begin() + i * m_item_size);
+	m_hits.erase(m_hits.begin(), m_hits.begin() + h);
+
+	return nitems;
+}
+
+
+/*
+ * work() loop for THRESHOLD_AVERAGE on gr_complex input.
+ */
+int omnipod_core::work_average(const void *in, unsigned int nitems) {
+
+	PROFILE_SCOPE(PROFILE_ENVELOPE);
+	const omnipod_complex *inc = (const omnipod_complex *)in;
+	unsigned int i, j;
+	float cur;
+	double avg;
+
+
+	for(i = 0; i + 2 * m_average_len + 1 < nitems; i++) {
+
+		// save input signal; the sample being decided, not the oldest in the window
+		save_sample(&inc[i + m_average_len + 1]);
+
+		// 0 1 ... (len - 1) len (len + 1) ... (len + len - 1) 2len (2len + 1)
+		//                          cur
+
+		// pre-compute initial average
+		if(m_starting) {
+			m_average_a = 0;
+			m_average_b = 0;
+			for(j = 0; j < m_average_len; j++) {
+				m_average_a += std::abs(inc[m_average_len + 1 + j]);
+				m_average_b += std::abs(inc[j]);
+			}
+			m_sample_number = m_sample_base + m_average_len;
+			m_starting = 0;
+		}
+
+		m_sample_number += 1;
+
+		// running averages
+		cur = std::abs(inc[i + m_average_len + 1]);
+		m_average_a = m_average_a - cur + std::abs(inc[i + 2 * m_average_len + 1]);
+		m_average_b = m_average_b - std::abs(inc[i]) + std::abs(inc[i + m_average_len]);
+
+		/*
+		 * The start of the burst uses averages after the
+		 * current sample.  The rest of the burst uses averages
+		 * before the current sample.
+		 */
+		if(m_dbuf_count <= 2 * m_avg_n) {
+			avg = m_average_a / m_average_len;
+		} else {
+			avg = m_average_b / m_average_len;
+		}
+
+		decide(!(cur < avg), cur);
+	}
+
+	return i;
+}
+
+
+/*
+ * Demodulate nitems input items starting at in.  Returns the number of items
+ * used up; the caller passes the rest again on the next call together with
+ * any new ones.
+ */
+unsigned int omnipod_core::work(const void *in, unsigned int nitems) {
+
+	std::string prefix;
+	double seconds;
+	unsigned int n;
+
+	m_work_time = now();
+
+	// asked for by snapshot()
+	if(m_snapshot_requested) {
+		pthread_mutex_lock(&m_snapshot_mutex);
+		prefix = m_request_prefix;
+		seconds = m_request_seconds;
+		m_snapshot_requested = 0;
+		pthread_mutex_unlock(&m_snapshot_mutex);
+		take_snapshot(prefix, seconds, 0);
+	}
+
+	if(m_threshold == THRESHOLD_TRACKER)
+		n = work_tracker(in, nitems);
+	else if(m_threshold == THRESHOLD_MATCHED)
+		n = work_matched(in, nitems);
+	else if(m_short_input)
+		n = work_short((const short *)in, nitems);
+	else
+		n = work_average(in, nitems);
+
+	m_stats.samples += n;
+
+	// a burst not yet begun cannot start before this
+	if(m_messages.pending() && !m_record && !busy() && m_sample_number > m_count + m_jitter + 1 + m_delay)
+		expire_messages(m_sample_number - (m_count + m_jitter + 1 + m_delay));
+
+	check_realtime(nitems, n);
+	if(m_sfp && now() >= m_stats_next) {
+		write_stats();
+		m_stats_next += m_stats_interval;
+	}
+
+	return n;
+}
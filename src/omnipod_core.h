@@ -0,0 +1,416 @@
+#ifndef INCLUDED_OMNIPOD_CORE_H
+#define INCLUDED_OMNIPOD_CORE_H
+
+/*
+ * omnipod_core
+ *
+ * The demodulator without any GNU Radio dependency.  omnipod_demod wraps this
+ * in a gr_block and omnidecode drives it directly from a file.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <complex>
+#include <string>
+#include <vector>
+#include "circular_buffer.h"
+#include "latency_histogram.h"
+#include "trace_ring.h"
+#include "preamble_detector.h"
+#include "frame_check.h"
+#include "burst_cache.h"
+#include "message_assembler.h"
+#include "line_decoder.h"
+#include "snapshot_writer.h"
+
+typedef std::complex<float> omnipod_complex;	// same layout as gr_complex
+
+typedef enum {
+	REP_COMPRESSED,
+	REP_NRZ,
+	REP_MANCHESTER_STRICT,
+	REP_MANCHESTER,
+	REP_DECODE,
+	REP_SOFT,
+	REP_FM0,
+	REP_DIFF_MANCHESTER,
+	REP_8B10B
+} rep_type;
+
+typedef enum {
+	THRESHOLD_AVERAGE,		// boxcar averages either side of the sample
+	THRESHOLD_TRACKER,		// attack / decay envelope follower
+	THRESHOLD_MATCHED		// preamble matched filter, then fixed for the burst
+} threshold_type;
+
+/*
+ * Latency from the work() call that delivered a burst's last symbol to its
+ * output being written, and its parts.
+ */
+typedef enum {
+	LATENCY_TOTAL,
+	LATENCY_WAIT,			// for the run that ends the burst
+	LATENCY_DECODE,			// in represent(), less writing
+	LATENCY_WRITE,			// writing the output
+	LATENCY_STAGES
+} latency_type;
+
+typedef enum {
+	PIECE_TEXT,			// output text
+	PIECE_STDOUT,			// text that only goes to the screen
+	PIECE_SAMPLE			// "sample:" field, filled in by emit()
+} piece_type;
+
+struct omnipod_piece {
+	int		type;
+	int		sink;			// 0 for the output, else the add_representation() it came from
+	std::string	text;
+};
+
+/*
+ * A representation run on every burst as well as the one chosen with
+ * set_representation(), and where its text goes.
+ */
+struct omnipod_sink {
+	int		rep;
+	FILE *		fp;
+};
+
+/*
+ * Envelope levels of a burst in input units, summed as the slicer goes over
+ * its symbols.  The noise floor is measured over the idle lows before it and
+ * snr is the high level over it, in dB.
+ */
+struct omnipod_levels {
+	float		mean;
+	float		peak;
+	float		high;			// mean over the high symbols
+	float		low;			// and the low ones
+	float		noise;
+	float		snr;
+};
+
+/*
+ * A burst's output as recorded by record_bursts().
+ */
+struct omnipod_burst {
+	unsigned long long		start;		// starting sample number
+	std::vector<omnipod_piece>	pieces;		// output in order
+	int				save;		// burst goes to the capture file
+	int				invalid;	// failed the frame checks
+	unsigned long long		hash;		// of the symbols, if looking for repeats
+	std::string			frame;		// bits after the preamble, if reassembling
+	omnipod_levels			levels;
+	std::vector<omnipod_complex>	signal;		// burst samples, if recording them
+};
+
+/*
+ * Counters kept by every instance; get_stats() returns a copy.  runs[] is
+ * indexed by width in symbols and half_runs[] by the whole part of a
+ * half-symbol width (0.5, 1.5, 2.5).
+ */
+struct omnipod_stats {
+	unsigned long long	samples;		// items demodulated
+	unsigned long long	transitions;		// runs handed to slice()
+	unsigned long long	runs[7];		// runs of 1 - 6 symbols
+	unsigned long long	half_runs[3];		// half-symbol violations
+	unsigned long long	rejected;		// runs that matched no width
+	unsigned long long	bursts_started;
+	unsigned long long	bursts_finished;
+	unsigned long long	bursts_truncated;	// represented early at set_max_burst()
+	unsigned long long	bursts_timed_out;	// ended by set_burst_timeout()
+	unsigned long long	buffer_grows;		// times the symbol buffers were enlarged
+	unsigned long long	errors_phase;		// '*' from manchester_decode()
+	unsigned long long	errors_impossible;	// '#'
+	unsigned long long	errors_unknown;		// 'X'
+	unsigned long long	preamble_hits;		// every representation but REP_COMPRESSED, REP_NRZ and REP_MANCHESTER
+	unsigned long long	preamble_misses;
+	unsigned long long	frames_checked;		// frames given to the frame checks
+	unsigned long long	frames_invalid;		// and failed them
+	unsigned long long	repeat_lookups;		// bursts looked for in the repeat cache
+	unsigned long long	repeats;		// found there, and not written out again
+	unsigned long long	repeat_evictions;	// entries pushed out inside their window
+	unsigned long long	messages_complete;	// reassembled messages
+	unsigned long long	messages_incomplete;	// given up on
+	unsigned long long	message_gaps;		// frames that skipped sequence numbers
+	unsigned long long	message_out_of_order;	// frames dropped as already passed
+	unsigned long long	snapshots;		// of the raw input, written
+	unsigned long long	snapshots_dropped;	// writer too far behind, or the file failed
+	double			represent_time;		// seconds spent in represent()
+	unsigned long long	work_calls;
+	double			work_time;		// seconds spent in work()
+	double			worst_call;		// longest work() call, seconds
+	unsigned long long	worst_call_items;	// items it was given
+	double			recent_rtf;		// work time over sample time, last second or so
+	unsigned long long	lag_warnings;
+	unsigned long long	backlog_warnings;
+};
+
+
+class omnipod_core {
+public:
+	omnipod_core(double clock_speed = 64e6, unsigned int decimation = 256, int short_input = 0);
+	~omnipod_core();
+	unsigned int work(const void *in, unsigned int nitems);
+	unsigned int history();
+	unsigned int item_size();
+	void set_representation(int rep);
+	void set_threshold(int threshold);
+	void set_output(char *filename);
+	void set_capture(char *filename);
+	void show_hex();
+	void show_power();
+	void show_samples();
+	void set_quiet();
+	void print(const char *text);
+	unsigned long long burst_count();
+	omnipod_stats get_stats();
+	omnipod_levels burst_levels();
+	void set_stats_file(char *filename, double interval);
+	void monitor_realtime(double max_backlog);
+	double latency(int stage, double p);
+	unsigned long long latency_count();
+	void reset_latency();
+	void dump_trace(char *filename);
+	void set_trace_file(char *filename);
+	void snapshot(char *filename, double seconds);
+	void set_snapshot(char *filename, double seconds);
+	void set_frame_check(char *spec);
+	void set_invalid_output(char *filename);
+	void set_repeat_window(double seconds);
+	void set_reassembly(double timeout);
+	void set_burst_timeout(double symbols);
+	void set_max_burst(double seconds);
+	void add_representation(int rep, char *filename);
+
+	void record_bursts(int capture);
+	void take_bursts(std::vector<omnipod_burst> &bursts);
+	void emit(const omnipod_burst &burst);
+	void set_start(unsigned long long sample);
+	unsigned int overlap();
+	int busy();
+
+	static unsigned int manchester_decode(unsigned char *dbuf, unsigned int dbuf_count, char *data, unsigned int max_data_len);
+
+private:
+	friend class omnipod_bench;
+
+	double		m_clock_speed;
+	unsigned int	m_decimation;
+
+	double		m_sr;				// sample rate
+	unsigned int	m_sps;				// samples per symbol, rounded, for window lengths
+	unsigned int	m_sps_q16;			// samples per symbol, 16.16 fixed point
+	unsigned int	m_burst_sps;			// this burst's estimate, 16.16
+	int		m_phase;			// 16.16 samples the last edge is late by on that grid
+	unsigned int	m_edges;			// edges since the end of the burst's first run
+	long long	m_edge_t;			// samples since then
+	long long	m_edge_h;			// half-symbols since then
+	long long	m_sum_t, m_sum_h, m_sum_hh, m_sum_ht;	// for the least squares fit of t against h
+	int		m_origin;			// 16.16 where the fit puts the end of the first run
+	unsigned int	m_first_len;			// samples in the burst's first run
+	unsigned int	m_first_halves;			// half-symbols in it
+	int		m_anchored;			// this burst is timed from the preamble_hit that armed it
+	unsigned int	m_anchor_lead;			// samples from the hit's first sample to the first run's
+	double		m_anchor_late;			// samples the first run starts after the preamble does
+	double		m_anchor_t;			// where the preamble starts, samples since the end of the first run
+	long long	m_anchor_h;			// and half-symbols since then
+	std::vector<float> m_soft;			// envelope of the burst for decode_soft()
+	unsigned int	m_jitter;			// amplitude must hold for at least this many samples to count
+
+	unsigned int	m_average_len;
+	double		m_average_a;			// average of samples after current
+	double		m_average_b;			// average of samples before current
+
+	int		m_short_input;			// input is interleaved 16-bit I/Q
+	unsigned int	m_item_size;			// size of an input item
+	long long	m_iaverage_a;			// fixed-point m_average_a
+	long long	m_iaverage_b;			// fixed-point m_average_b
+
+	threshold_type	m_threshold;			// how the slicing threshold is found
+	unsigned int	m_delay;			// samples between input and slicer
+	double		m_high;				// tracked high level
+	double		m_low;				// tracked low level
+	double		m_attack;			// tracker coefficient towards a new extreme
+	double		m_decay;			// tracker coefficient back from an extreme
+
+	preamble_detector *m_detector;			// THRESHOLD_MATCHED acquisition
+	std::vector<float> m_env;			// envelope of items waiting for the detector
+	std::vector<char> m_pending;			// the items themselves
+	unsigned long long m_sliced;			// items handed to the slicer
+	std::vector<preamble_hit> m_hits;		// preambles not yet reached by the slicer
+	int		m_seed;				// a hit has armed the threshold and no burst has started since
+	unsigned long long m_seed_first;		// m_saved count at the hit's first sample
+	double		m_seed_offset;			// and its fractional correction
+	double		m_burst_threshold;		// threshold for this burst, HUGE_VAL between bursts
+	unsigned int	m_below;			// samples under it in a row
+
+	int		m_sign;				// last sample was over / under average
+	unsigned int	m_count;			// count of over / under
+	unsigned int	m_change_count;			// don't change sign unless passed jitter threshold
+	unsigned int	m_burst_timeout;		// a run this long ends the burst at once; UINT_MAX for never
+	double		m_run_sum;			// envelope summed over the run
+	float		m_run_peak;
+	double		m_change_sum;			// and over m_change_count
+	float		m_change_peak;
+	double		m_burst_sum, m_high_sum, m_low_sum;	// over the burst's symbols
+	unsigned int	m_burst_n, m_high_n, m_low_n;
+	float		m_burst_peak;
+	double		m_noise;			// noise floor, -1 until measured
+	unsigned int	m_noise_len;			// samples it is averaged over
+	omnipod_levels	m_levels;			// of the last burst
+
+	std::vector<unsigned char> m_dbuf;		// buffer for demodulated signal, grown by fit_burst()
+	unsigned int	m_dbuf_count;			// number of valid symbols in dbuf
+	unsigned int	m_max_symbols;			// most m_dbuf may grow to
+	unsigned long long m_dbuf_grows;		// times fit_burst() has grown it
+	std::vector<unsigned char> m_dcopy;		// decoders' scratch, the size of m_dbuf
+	std::vector<char> m_bits;			// and twice that
+	std::vector<char> m_bits2;
+	std::vector<unsigned int> m_errors;
+
+	rep_type	m_rep;				// representation type
+	std::vector<omnipod_sink> m_sinks;		// representations added to it
+	int		m_sink;				// being written: 0, or 1 + index in m_sinks
+	std::vector<char> m_data;			// manchester_decode() of the burst, once asked for
+	int		m_data_len;			// -1 until then
+	int		m_hex;				// display in hex
+
+	FILE *		m_fp;				// output file stream
+	FILE *		m_rfp;				// raw output file stream
+
+	circular_buffer *m_cb;				// circular buffer to save raw input
+	unsigned long long m_saved;			// items written to m_cb
+	unsigned long long m_signal_first;		// the burst's samples are a view of m_cb: m_saved at the first
+	unsigned int	m_signal_len;			// and how many
+	unsigned int	m_max_signal;			// most samples a burst's view may hold
+	unsigned int	m_pin_len;			// a burst ends before its first sample is this old
+
+	int		m_show_power;			// display average power when burst displayed
+	int		m_show_samples;			// display starting sample of each burst
+
+	int		m_starting;			// no samples seen yet
+	unsigned long long m_sample_base;		// stream position of first item
+
+	int		m_record;			// record bursts rather than write them
+	int		m_record_capture;		// record burst samples too
+	std::vector<omnipod_burst> m_bursts;		// recorded bursts
+	omnipod_burst *	m_burst;			// burst being recorded
+
+	int		m_quiet;			// don't write to the screen
+	unsigned long long m_nbursts;			// bursts represented
+
+	unsigned long long m_sample_number;		// current sample number;
+	unsigned long long m_signal_start;		// current signal starting number
+	unsigned long long m_last_signal_start;		// last signal starting number
+
+	double		m_power;			// mean envelope of current signal
+
+	omnipod_stats	m_stats;			// counters
+	FILE *		m_sfp;				// stats file stream
+	double		m_stats_interval;		// seconds between lines in the stats file
+	double		m_stats_next;			// time of the next line
+
+	int		m_monitor;			// warn when falling behind real time
+	double		m_max_backlog;			// warn when given more than this many seconds of input
+	double		m_last_warning;			// when the last warning was given
+
+	latency_histogram m_latency[LATENCY_STAGES];	// per-burst latency by stage
+	double		m_work_time;			// when the current work() call started
+	double		m_symbol_time;			// work() call of the last valid symbol
+	double		m_write_time;			// spent writing the current burst
+	int		m_output;			// current burst wrote something
+
+	trace_ring	m_trace;			// recent slicer decisions
+	FILE *		m_tfp;				// trace file stream for triggered dumps
+
+	snapshot_writer	m_snapshots;			// raw input, written on its own thread
+	std::string	m_snapshot_prefix;		// trigger() takes a snapshot too, if seconds > 0
+	double		m_snapshot_seconds;
+	unsigned long long m_snapshot_end;		// m_saved at the end of the last one trigger() took
+	pthread_mutex_t	m_snapshot_mutex;		// guards the request below
+	volatile int	m_snapshot_requested;		// snapshot() was called; work() takes it
+	std::string	m_request_prefix;
+	double		m_request_seconds;
+
+	frame_check	m_frame;
+	FILE *		m_ifp;				// invalid frames go here, if set
+	int		m_invalid;			// current burst failed the frame checks
+
+	burst_cache	m_repeats;			// recent bursts by the hash of their symbols
+
+	message_assembler m_messages;			// messages spread over several bursts
+	std::string	m_frame_bits;			// current burst's frame, if it is to be added
+	std::vector<assembled_message> m_assembled;	// finished, not yet written
+
+	static const double	  m_symbol_rate = 4000;	// from documentation (assuming Manchester, bit rate is half this)
+	static const unsigned int m_avg_n = 8;		// average over 8 symbols
+	static const unsigned int m_cb_len = (1 << 20);	// circular buffer length, at least
+	static const unsigned int m_initial_symbols = 1024;	// room in m_dbuf to start with
+	static const double m_max_burst = 1.0;		// default set_max_burst(), seconds
+	static const double m_max_burst_limit = 60;
+
+	static const double m_error = 0.25;		// max error in width of symbol, all of it noise margin
+	static const double m_max_drift = 0.02;		// how far a burst's rate may stray from nominal
+	static const unsigned int m_rate_halves = 8;	// half-symbols seen before the rate is estimated
+	static const float m_match_score = 0.4;		// detector correlation that counts as a preamble
+
+	int work_average(const void *in, unsigned int nitems);
+	int work_short(const short *ins, unsigned int nitems);
+	int work_tracker(const void *in, unsigned int nitems);
+	int work_matched(const void *in, unsigned int nitems);
+	double track(double cur);
+	void track_rate(unsigned int halves);
+	void decide(int high, float level);
+	void extend_run(float level);
+	void save_sample(const void *item);
+	void extend_signal(unsigned long long end);
+	char *signal_samples(unsigned int *nitems);
+	void hold_run(float level);
+	void next_run(float level);
+	void add_run();
+	void track_noise();
+	void slice();
+	void start_burst();
+	void end_burst(unsigned int back, unsigned int len);
+	int fit_burst(unsigned int len);
+	void represent();
+	void decode(int rep);
+	unsigned int manchester(char *&data);
+	void save_signal();
+	void count_errors(const char *data, unsigned int data_len);
+	void write_stats();
+	void check_realtime(unsigned int nitems, unsigned int n);
+	float threshold_level();
+	void trigger(const char *reason);
+	void take_snapshot(const std::string &prefix, double seconds, int follow);
+	void capture_begin();
+	void capture_end();
+	void add_piece(int type, const char *text);
+	void show_sample();
+	void do_printf_stdout(const char *fmt, ...);
+	unsigned int signal_to_complex(const void *buf, unsigned int nitems, omnipod_complex *out, unsigned int out_len);
+	void do_printf(const char *fmt, ...);
+	void display_hex(char *data, unsigned int data_len);
+	void display_c_hex(char *data, unsigned int data_len);
+	void display_c_hex_bytes(char *data, unsigned int data_len);
+	void display_c_hex_bytes_le(char *data, unsigned int data_len);
+
+	void decode_compressed();
+	void decode_nrz();
+	void decode_manchester();
+	void decode_manchester_strict();
+	void decode_protocol();
+	int find_preamble(unsigned int &start, unsigned int &i);
+	int validate(const char *bits, unsigned int nbits, unsigned int markers);
+	int repeat(unsigned long long hash);
+	void remember(unsigned long long hash);
+	void assemble(const std::string &frame);
+	void expire_messages(unsigned long long sample);
+	void show_messages();
+	double grid(double halves);
+	float window(double from, double to);
+	void decode_soft();
+	void decode_line(line_decoder *d);
+};
+#endif /* INCLUDED_OMNIPOD_CORE_H */
@@ -0,0 +1,244 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdexcept>
+#include "omnipod_gen.h"
+
+
+omnipod_gen::omnipod_gen(double sample_rate, unsigned int seed) {
+
+	if(sample_rate < 2 * m_symbol_rate)
+		throw std::runtime_error("error: omnipod_gen: sample rate too low");
+
+	m_sr = sample_rate;
+	m_amplitude = 1;
+	m_jitter = 0;
+	m_ppm = 0;
+	m_gap_min = 5;
+	m_gap_max = 50;
+	m_nbits = 168;		// everything decode_protocol() looks at
+	m_coding = line_decoder::find("manchester");
+	m_state = seed? seed : 1;
+
+	set_snr(30);
+}
+
+
+/*
+ * Carrier power over noise power.
+ */
+void omnipod_gen::set_snr(double db) {
+
+	m_snr = db;
+	m_noise = m_amplitude / sqrt(2 * pow(10.0, db / 10));
+}
+
+
+void omnipod_gen::set_amplitude(double amplitude) {
+
+	m_amplitude = amplitude;
+	set_snr(m_snr);
+}
+
+
+/*
+ * Standard deviation of each transition's position, in symbols.
+ */
+void omnipod_gen::set_jitter(double jitter) {
+
+	m_jitter = jitter;
+}
+
+
+void omnipod_gen::set_clock_offset(double ppm) {
+
+	m_ppm = ppm;
+}
+
+
+/*
+ * Idle time before each burst is uniform in [min_ms, max_ms].
+ */
+void omnipod_gen::set_gap(double min_ms, double max_ms) {
+
+	if(max_ms < min_ms)
+		max_ms = min_ms;
+	m_gap_min = min_ms;
+	m_gap_max = max_ms;
+}
+
+
+void omnipod_gen::set_bits(unsigned int nbits) {
+
+	m_nbits = nbits;
+}
+
+
+/*
+ * Line coding of the data; 8b/10b sends whole bytes of the bits only.
+ */
+void omnipod_gen::set_coding(line_decoder *coding) {
+
+	m_coding = coding;
+}
+
+
+// xorshift32; the same sequence everywhere for a given seed
+unsigned int omnipod_gen::random() {
+
+	m_state ^= m_state << 13;
+	m_state ^= m_state >> 17;
+	m_state ^= m_state << 5;
+	return m_state;
+}
+
+
+double omnipod_gen::uniform() {
+
+	return (random() + 1.0) / 4294967297.0;
+}
+
+
+double omnipod_gen::gaussian() {
+
+	return sqrt(-2 * log(uniform())) * cos(2 * M_PI * uniform());
+}
+
+
+omnipod_complex omnipod_gen::noise() {
+
+	double i = gaussian(), q = gaussian();
+
+	return omnipod_complex(m_noise * i, m_noise * q);
+}
+
+
+void omnipod_gen::idle(std::vector<omnipod_complex> &out, unsigned int nitems) {
+
+	unsigned int i;
+
+	for(i = 0; i < nitems; i++)
+		out.push_back(noise());
+}
+
+
+void omnipod_gen::burst(std::vector<omnipod_complex> &out, omnipod_truth *truth) {
+
+	static const char *preamble = "1101111110";
+
+	std::vector<int> level;
+	std::vector<double> width;		// in symbols
+	std::vector<unsigned char> symbols;
+	std::string bits;
+	unsigned int i, n, prev, next;
+	double sps, t, b, phase;
+	omnipod_complex carrier;
+
+
+	// Manchester: 1 is high-low, 0 is low-high
+	for(i = 0; preamble[i]; i++) {
+		level.push_back(preamble[i] == '1');
+		level.push_back(preamble[i] != '1');
+		width.push_back(1);
+		width.push_back(1);
+	}
+
+	// the final high is held for another half-symbol
+	width.back() += 0.5;
+
+	for(i = 0; i < m_nbits; i++)
+		bits += (random() & 1)? '1' : '0';
+
+	// the preamble ends high
+	bits.resize(m_coding->encode(bits.data(), bits.size(), 1, symbols));
+	for(i = 0; i < symbols.size(); i++) {
+		level.push_back(symbols[i]);
+		width.push_back(1);
+	}
+
+	sps = m_sr / (m_symbol_rate * (1 + m_ppm * 1e-6));
+	phase = 2 * M_PI * uniform();
+	carrier = omnipod_complex(m_amplitude * cos(phase), m_amplitude * sin(phase));
+
+	if(truth) {
+		truth->start = out.size();
+		truth->bits = bits;
+		truth->runs.clear();
+	}
+
+	t = 0;
+	prev = 0;
+	for(i = 0; i < level.size(); i++) {
+		t += width[i] * sps;
+		b = t;
+		if(i + 1 < level.size())
+			b += m_jitter * sps * gaussian();
+		next = (b < 0.5)? 0 : (unsigned int)(b + 0.5);
+		if(next < prev)
+			next = prev;
+		for(n = prev; n < next; n++)
+			out.push_back(level[i]? carrier + noise() : noise());
+
+		if(truth && next > prev) {
+			if(truth->runs.size() && truth->runs.back().level == level[i]) {
+				truth->runs.back().width += next - prev;
+			} else {
+				truth->runs.push_back(omnipod_run());
+				truth->runs.back().level = level[i];
+				truth->runs.back().width = next - prev;
+			}
+		}
+		prev = next;
+	}
+
+	if(truth)
+		truth->end = out.size();
+}
+
+
+/*
+ * nbursts bursts, each after an idle gap, and a final gap so the last one
+ * is terminated.
+ */
+void omnipod_gen::generate(std::vector<omnipod_complex> &out, unsigned int nbursts, std::vector<omnipod_truth> *truth) {
+
+	unsigned int i;
+	double ms;
+
+	for(i = 0; i <= nbursts; i++) {
+		ms = m_gap_min + (m_gap_max - m_gap_min) * uniform();
+		idle(out, (unsigned int)(ms * m_sr / 1000));
+		if(i == nbursts)
+			break;
+		if(truth) {
+			truth->push_back(omnipod_truth());
+			burst(out, &truth->back());
+		} else
+			burst(out);
+	}
+}
+
+
+/*
+ * Interleaved 16-bit I/Q as the USRP delivers it.
+ */
+void omnipod_gen::to_short(const std::vector<omnipod_complex> &in, std::vector<short> &out, double scale) {
+
+	unsigned int i, j;
+	double v[2];
+
+	out.resize(2 * in.size());
+	for(i = 0; i < in.size(); i++) {
+		v[0] = in[i].real() * scale;
+		v[1] = in[i].imag() * scale;
+		for(j = 0; j < 2; j++) {
+			if(v[j] > 32767)
+				v[j] = 32767;
+			if(v[j] < -32768)
+				v[j] = -32768;
+			out[2 * i + j] = (short)lrint(v[j]);
+		}
+	}
+}
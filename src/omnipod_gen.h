@@ -0,0 +1,73 @@
+#ifndef INCLUDED_OMNIPOD_GEN_H
+#define INCLUDED_OMNIPOD_GEN_H
+
+/*
+ * omnipod_gen
+ *
+ * Synthetic Omnipod-like bursts for benchmarks and regression runs.  Each
+ * burst is OOK at m_symbol_rate: the Manchester preamble 1101111110, the
+ * last half-symbol held for an extra half-symbol (the "^" violation), then
+ * Manchester data.  A 1 is sent high-low and a 0 low-high, which is what
+ * manchester_decode() expects.  set_coding() sends the data in another of
+ * the line codings in line_decoder.h instead.
+ */
+
+#include <string>
+#include <vector>
+#include "omnipod_core.h"
+#include "line_decoder.h"
+
+struct omnipod_run {
+	int		level;			// 1 high, 0 low
+	unsigned int	width;			// samples
+};
+
+/*
+ * What went into one burst.
+ */
+struct omnipod_truth {
+	unsigned long long	start;		// first sample of the burst
+	unsigned long long	end;		// one past the last sample
+	std::string		bits;		// data bits after the preamble, '0' / '1'
+	std::vector<omnipod_run> runs;		// ideal slicer input
+};
+
+class omnipod_gen {
+public:
+	omnipod_gen(double sample_rate = 250e3, unsigned int seed = 1);
+
+	void set_snr(double db);
+	void set_amplitude(double amplitude);
+	void set_jitter(double jitter);
+	void set_clock_offset(double ppm);
+	void set_gap(double min_ms, double max_ms);
+	void set_bits(unsigned int nbits);
+	void set_coding(line_decoder *coding);
+
+	void idle(std::vector<omnipod_complex> &out, unsigned int nitems);
+	void burst(std::vector<omnipod_complex> &out, omnipod_truth *truth = 0);
+	void generate(std::vector<omnipod_complex> &out, unsigned int nbursts, std::vector<omnipod_truth> *truth = 0);
+
+	static void to_short(const std::vector<omnipod_complex> &in, std::vector<short> &out, double scale);
+
+private:
+	double		m_sr;				// sample rate
+	double		m_amplitude;			// carrier amplitude
+	double		m_noise;			// noise standard deviation per component
+	double		m_snr;				// in dB, relative to the carrier
+	double		m_jitter;			// transition jitter in symbols (standard deviation)
+	double		m_ppm;				// transmitter clock error
+	double		m_gap_min;			// idle time before a burst, ms
+	double		m_gap_max;
+	unsigned int	m_nbits;			// data bits per burst
+	line_decoder *	m_coding;			// of the data bits
+	unsigned int	m_state;			// random number state
+
+	static const double m_symbol_rate = 4000;
+
+	unsigned int random();
+	double uniform();
+	double gaussian();
+	omnipod_complex noise();
+};
+#endif /* INCLUDED_OMNIPOD_GEN_H */
@@ -0,0 +1,166 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <sys/time.h>
+#include "omnipod_profile.h"
+
+#ifdef OMNIPOD_PROFILE
+
+#include <pthread.h>
+#include <vector>
+
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<profile_counts *> profile_threads;	// kept after the thread exits
+static __thread profile_counts *profile_mine;
+
+
+/*
+ * This thread's table, registered on first use.
+ */
+profile_counts *omnipod_profile_thread() {
+
+	if(!profile_mine) {
+		profile_mine = new profile_counts;
+		memset(profile_mine, 0, sizeof(*profile_mine));
+		pthread_mutex_lock(&profile_lock);
+		profile_threads.push_back(profile_mine);
+		pthread_mutex_unlock(&profile_lock);
+	}
+	return profile_mine;
+}
+
+
+int omnipod_profile_enabled() {
+
+	return 1;
+}
+
+
+/*
+ * Totals over all threads.  The tables are read without stopping their
+ * threads, so a total may be a call behind.
+ */
+unsigned long long omnipod_profile_ticks(int stage) {
+
+	unsigned long long n = 0;
+	unsigned int i;
+
+	if(stage < 0 || stage >= PROFILE_STAGES)
+		return 0;
+	pthread_mutex_lock(&profile_lock);
+	for(i = 0; i < profile_threads.size(); i++)
+		n += profile_threads[i]->ticks[stage];
+	pthread_mutex_unlock(&profile_lock);
+	return n;
+}
+
+
+unsigned long long omnipod_profile_calls(int stage) {
+
+	unsigned long long n = 0;
+	unsigned int i;
+
+	if(stage < 0 || stage >= PROFILE_STAGES)
+		return 0;
+	pthread_mutex_lock(&profile_lock);
+	for(i = 0; i < profile_threads.size(); i++)
+		n += profile_threads[i]->calls[stage];
+	pthread_mutex_unlock(&profile_lock);
+	return n;
+}
+
+
+/*
+ * Best called while the demodulator is idle; a count being added to as it
+ * is cleared may keep that one addition.
+ */
+void omnipod_profile_reset() {
+
+	unsigned int i;
+
+	pthread_mutex_lock(&profile_lock);
+	for(i = 0; i < profile_threads.size(); i++)
+		memset(profile_threads[i], 0, sizeof(*profile_threads[i]));
+	pthread_mutex_unlock(&profile_lock);
+}
+
+
+/*
+ * Ticks per nanosecond, measured over 10ms the first time.
+ */
+static double ticks_per_ns() {
+
+	static double rate = 0;
+
+	struct timeval start, now;
+	unsigned long long t;
+	double us;
+
+	if(rate > 0)
+		return rate;
+	gettimeofday(&start, 0);
+	t = profile_now();
+	do {
+		gettimeofday(&now, 0);
+		us = (now.tv_sec - start.tv_sec) * 1e6 + (now.tv_usec - start.tv_usec);
+	} while(us < 10000);
+	rate = (profile_now() - t) / (us * 1e3);
+	return rate;
+}
+
+
+void omnipod_profile_dump(FILE *fp) {
+
+	static const char *stage_name[] = {"envelope", "decide", "slice", "represent", "decode_compressed", "decode_nrz",
+	   "decode_manchester", "decode_manchester_strict", "decode_protocol", "decode_soft", "decode_line", "save_signal"};
+
+	unsigned int i, j;
+	double rate = ticks_per_ns();
+	profile_counts *c;
+
+	pthread_mutex_lock(&profile_lock);
+	for(i = 0; i < profile_threads.size(); i++) {
+		c = profile_threads[i];
+		fprintf(fp, "profile: thread %u\n", i);
+		for(j = 0; j < PROFILE_STAGES; j++) {
+			if(!c->calls[j])
+				continue;
+			fprintf(fp, "\t%-26s %12llu calls %16llu ticks %12.1f ns/call\n", stage_name[j], c->calls[j], c->ticks[j],
+			   c->ticks[j] / rate / c->calls[j]);
+		}
+	}
+	pthread_mutex_unlock(&profile_lock);
+}
+
+#else
+
+int omnipod_profile_enabled() {
+
+	return 0;
+}
+
+
+unsigned long long omnipod_profile_ticks(int) {
+
+	return 0;
+}
+
+
+unsigned long long omnipod_profile_calls(int) {
+
+	return 0;
+}
+
+
+void omnipod_profile_reset() {
+}
+
+
+void omnipod_profile_dump(FILE *fp) {
+
+	fprintf(fp, "profile: not enabled (configure --enable-profile-timers)\n");
+}
+
+#endif /* OMNIPOD_PROFILE */
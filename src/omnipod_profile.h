@@ -0,0 +1,92 @@
+#ifndef INCLUDED_OMNIPOD_PROFILE_H
+#define INCLUDED_OMNIPOD_PROFILE_H
+
+/*
+ * omnipod_profile
+ *
+ * Scoped timers for the demodulator stages, compiled in with
+ * ./configure --enable-profile-timers (OMNIPOD_PROFILE).  Otherwise
+ * PROFILE_SCOPE() is empty and the functions below report zeros.
+ *
+ * Each thread counts into its own table, so timing costs a counter read at
+ * each end of the scope and two adds.  Times are inclusive: PROFILE_SLICE
+ * includes the represent() it calls.  Ticks are TSC cycles on x86 and
+ * nanoseconds elsewhere.
+ */
+
+#include <stdio.h>
+
+typedef enum {
+	PROFILE_ENVELOPE,		// a work() loop, per call
+	PROFILE_DECIDE,			// hysteresis, per sample
+	PROFILE_SLICE,
+	PROFILE_REPRESENT,
+	PROFILE_DECODE_COMPRESSED,
+	PROFILE_DECODE_NRZ,
+	PROFILE_DECODE_MANCHESTER,
+	PROFILE_DECODE_MANCHESTER_STRICT,
+	PROFILE_DECODE_PROTOCOL,
+	PROFILE_DECODE_SOFT,
+	PROFILE_DECODE_LINE,
+	PROFILE_SAVE_SIGNAL,
+	PROFILE_STAGES
+} profile_stage;
+
+struct profile_counts {
+	unsigned long long	ticks[PROFILE_STAGES];
+	unsigned long long	calls[PROFILE_STAGES];
+};
+
+int omnipod_profile_enabled();
+unsigned long long omnipod_profile_ticks(int stage);
+unsigned long long omnipod_profile_calls(int stage);
+void omnipod_profile_reset();
+void omnipod_profile_dump(FILE *fp);
+
+#ifdef OMNIPOD_PROFILE
+
+#include <time.h>
+
+profile_counts *omnipod_profile_thread();
+
+static inline unsigned long long profile_now() {
+
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned int lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((unsigned long long)hi << 32) | lo;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+class profile_scope {
+public:
+	profile_scope(int stage) : m_stage(stage), m_start(profile_now()) {
+	}
+
+	~profile_scope() {
+
+		profile_counts *c = omnipod_profile_thread();
+
+		c->ticks[m_stage] += profile_now() - m_start;
+		c->calls[m_stage] += 1;
+	}
+
+private:
+	int			m_stage;
+	unsigned long long	m_start;
+};
+
+#define PROFILE_SCOPE(stage)	profile_scope profile_scope_(stage)
+
+#else
+
+#define PROFILE_SCOPE(stage)
+
+#endif /* OMNIPOD_PROFILE */
+#endif /* INCLUDED_OMNIPOD_PROFILE_H */
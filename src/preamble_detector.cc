@@ -0,0 +1,226 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdexcept>
+#include "preamble_detector.h"
+
+
+/*
+ * sps is samples per symbol and need not be a whole number.
+ */
+preamble_detector::preamble_detector(double sps, float threshold) {
+
+	static const char *preamble = "1101111110";
+
+	std::vector<int> level;
+	unsigned int i, k;
+	double t;
+
+	if(sps < 2)
+		throw std::runtime_error("error: preamble_detector: too few samples per symbol");
+
+	// Manchester 1 is high-low, 0 low-high; the last high lasts a half-symbol longer
+	for(i = 0; preamble[i]; i++) {
+		level.push_back(preamble[i] == '1');
+		level.push_back(preamble[i] != '1');
+	}
+	m_len = (unsigned int)((level.size() + 0.5) * sps + 0.5);
+	m_high_len = 0;
+	for(k = 0; k < m_len; k++) {
+		t = (k + 0.5) / sps;
+		i = (t < level.size())? (unsigned int)t : level.size() - 1;
+		m_template.push_back(level[i]? 1 : -1);
+		m_high_len += level[i];
+	}
+	m_balance = 2.0 * m_high_len - m_len;
+	m_spread = m_len - m_balance * m_balance / m_len;
+
+	// at least twice the template so each block scores as many windows as it overlaps
+	for(m_log2 = 1, m_fft_len = 2; m_fft_len < 2 * m_len; m_log2++)
+		m_fft_len <<= 1;
+
+	m_twiddle.resize(m_fft_len / 2);
+	for(k = 0; k < m_fft_len / 2; k++)
+		m_twiddle[k] = fft_complex(cos(2 * M_PI * k / m_fft_len), -sin(2 * M_PI * k / m_fft_len));
+
+	// correlation is convolution with the reversed template
+	m_filter.assign(m_fft_len, 0);
+	for(k = 0; k < m_len; k++)
+		m_filter[k] = m_template[m_len - 1 - k];
+	fft(&m_filter[0], 0);
+	m_work.resize(m_fft_len);
+
+	// running sums over two blocks, sized once
+	m_sum.resize(m_fft_len + (m_fft_len - m_len + 1) + 1);
+	m_sum2.resize(m_sum.size());
+
+	m_in_base = 0;
+	m_done = 0;
+	m_peak = 0;
+	m_peak_end = 0;
+	m_prev_score = 0;
+	m_last_hit = 0;
+	m_hits = 0;
+	set_threshold(threshold);
+}
+
+
+void preamble_detector::set_threshold(float threshold) {
+
+	m_threshold = threshold;
+}
+
+
+/*
+ * Samples in the preamble waveform.
+ */
+unsigned int preamble_detector::length() {
+
+	return m_len;
+}
+
+
+/*
+ * Every hit starting before this sample has been returned.
+ */
+unsigned long long preamble_detector::ready() {
+
+	// a hit being looked for can only move later
+	if(m_peak)
+		return m_best.start;
+	return m_done;
+}
+
+
+/*
+ * In-place radix-2 FFT; the inverse is unscaled.
+ */
+void preamble_detector::fft(fft_complex *x, int inverse) {
+
+	unsigned int i, j, k, n, half, step;
+	fft_complex w, t;
+
+	for(i = 0, j = 0; i < m_fft_len; i++) {
+		if(i < j)
+			std::swap(x[i], x[j]);
+		for(k = m_fft_len >> 1; k && (j & k); k >>= 1)
+			j ^= k;
+		j |= k;
+	}
+
+	for(n = 2; n <= m_fft_len; n <<= 1) {
+		half = n >> 1;
+		step = m_fft_len / n;
+		for(i = 0; i < m_fft_len; i += n) {
+			for(k = 0; k < half; k++) {
+				w = inverse? std::conj(m_twiddle[k * step]) : m_twiddle[k * step];
+				t = w * x[i + k + half];
+				x[i + k + half] = x[i + k] - t;
+				x[i + k] += t;
+			}
+		}
+	}
+}
+
+
+/*
+ * Score the window starting at start, over which the correlation is corr
+ * and the envelope and its square sum to sum and sum2.
+ */
+void preamble_detector::score(unsigned long long start, double corr, double sum, double sum2, std::vector<preamble_hit> &hits) {
+
+	double var = sum2 - sum * sum / m_len, a, b, c, d;
+	float s;
+
+	s = (var > 0)? (corr - sum / m_len * m_balance) / sqrt(m_spread * var) : 0;
+
+	if(m_peak) {
+		// a better window restarts the search; a weak hit on a burst tail must not hide the next preamble
+		if(s > m_best.score) {
+			m_peak_end = start + m_len;
+			m_best.start = start;
+			m_best.score = s;
+			m_best.high = (sum + corr) / 2 / m_high_len;
+			m_best.low = (sum - corr) / 2 / (m_len - m_high_len);
+			m_best.offset = m_prev_score;		// score before, for now
+		} else if(start == m_best.start + 1) {
+			// parabola through the best and its neighbours
+			a = m_best.offset;
+			b = m_best.score;
+			c = s;
+			d = a - 2 * b + c;
+			m_best.offset = (d < 0)? 0.5 * (a - c) / d : 0;
+			if(m_best.offset > 0.5)
+				m_best.offset = 0.5;
+			if(m_best.offset < -0.5)
+				m_best.offset = -0.5;
+		}
+		if(start >= m_peak_end && start > m_best.start + 1) {
+			hits.push_back(m_best);
+			m_last_hit = m_best.start;
+			m_hits += 1;
+			m_peak = 0;
+		}
+	} else if(s >= m_threshold && (!m_hits || start >= m_last_hit + m_len)) {
+		m_peak = 1;
+		m_peak_end = start + m_len;
+		m_best.start = start;
+		m_best.score = s;
+		m_best.high = (sum + corr) / 2 / m_high_len;
+		m_best.low = (sum - corr) / 2 / (m_len - m_high_len);
+		m_best.offset = m_prev_score;
+	}
+	m_prev_score = s;
+}
+
+
+/*
+ * Add nitems of envelope and return any hits that are now certain.
+ */
+void preamble_detector::process(const float *env, unsigned int nitems, std::vector<preamble_hit> &hits) {
+
+	unsigned int i, b, blocks, n, valid = m_fft_len - m_len + 1;
+	double *sum = &m_sum[0], *sum2 = &m_sum2[0];
+	float v;
+
+	m_in.insert(m_in.end(), env, env + nitems);
+	while(m_in.size() >= m_fft_len) {
+
+		/*
+		 * The template is real, so two blocks go through one transform:
+		 * the second as the imaginary part comes back as the imaginary
+		 * part of the result.
+		 */
+		blocks = (m_in.size() >= m_fft_len + valid)? 2 : 1;
+		for(i = 0; i < m_fft_len; i++)
+			m_work[i] = fft_complex(m_in[i], (blocks > 1)? m_in[valid + i] : 0);
+		fft(&m_work[0], 0);
+		for(i = 0; i < m_fft_len; i++)
+			m_work[i] *= m_filter[i];
+		fft(&m_work[0], 1);
+
+		// running sums for the normalization
+		n = (blocks - 1) * valid + m_fft_len;
+		sum[0] = 0;
+		sum2[0] = 0;
+		for(i = 0; i < n; i++) {
+			sum[i + 1] = sum[i] + m_in[i];
+			sum2[i + 1] = sum2[i] + m_in[i] * m_in[i];
+		}
+
+		// outputs m_len - 1 .. m_fft_len - 1 are free of wrap-around
+		for(b = 0; b < blocks; b++) {
+			for(i = 0; i < valid; i++) {
+				v = b? m_work[i + m_len - 1].imag() : m_work[i + m_len - 1].real();
+				n = b * valid + i;
+				score(m_in_base + n, v / m_fft_len, sum[n + m_len] - sum[n], sum2[n + m_len] - sum2[n], hits);
+			}
+		}
+
+		m_in.erase(m_in.begin(), m_in.begin() + blocks * valid);
+		m_in_base += blocks * valid;
+		m_done = m_in_base;
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef INCLUDED_PREAMBLE_DETECTOR_H
+#define INCLUDED_PREAMBLE_DETECTOR_H
+
+/*
+ * preamble_detector
+ *
+ * Matched filter for the preamble on the envelope.  The envelope is
+ * correlated against the ideal preamble waveform (+1 high, -1 low) by
+ * overlap-save FFT convolution, so the cost per sample is fixed whatever the
+ * signal.  The score is the correlation coefficient over the window: about 1
+ * for a preamble well above the noise and about 0 for noise alone, whatever
+ * the gain.
+ *
+ * A hit is a window start above the threshold whose score is not beaten
+ * within a template length after it.
+ */
+
+#include <complex>
+#include <vector>
+
+struct preamble_hit {
+	unsigned long long	start;		// first sample of the preamble
+	double			offset;		// fractional correction to start, -0.5 to 0.5
+	float			score;		// correlation coefficient
+	float			high;		// mean envelope while high
+	float			low;		// mean envelope while low
+};
+
+class preamble_detector {
+public:
+	preamble_detector(double sps, float threshold = 0.5);
+
+	void set_threshold(float threshold);
+	unsigned int length();
+	unsigned long long ready();
+	void process(const float *env, unsigned int nitems, std::vector<preamble_hit> &hits);
+
+private:
+	typedef std::complex<float> fft_complex;
+
+	std::vector<float>	m_template;		// +1 / -1
+	unsigned int		m_len;			// template length
+	unsigned int		m_high_len;		// samples of m_template that are high
+	double			m_balance;		// sum of m_template
+	double			m_spread;		// sum of squared deviations of m_template
+	unsigned int		m_fft_len;
+	unsigned int		m_log2;
+	std::vector<fft_complex> m_twiddle;
+	std::vector<fft_complex> m_filter;		// spectrum of the reversed template
+	std::vector<fft_complex> m_work;
+	std::vector<double>	m_sum;			// running sums of the envelope for the normalization
+	std::vector<double>	m_sum2;			// and of its square
+
+	std::vector<float>	m_in;			// envelope not yet correlated, with m_len - 1 of overlap
+	unsigned long long	m_in_base;		// sample number of m_in[0]
+	unsigned long long	m_done;			// window starts scored so far
+
+	float			m_threshold;
+	int			m_peak;			// looking for the best score
+	unsigned long long	m_peak_end;		// until this window start
+	preamble_hit		m_best;
+	float			m_prev_score;		// score of the previous window
+	unsigned long long	m_last_hit;		// start of the last hit
+	unsigned long long	m_hits;			// hits so far
+
+	void fft(fft_complex *x, int inverse);
+	void score(unsigned long long start, double corr, double sum, double sum2, std::vector<preamble_hit> &hits);
+};
+#endif /* INCLUDED_PREAMBLE_DETECTOR_H */
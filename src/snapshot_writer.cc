@@ -0,0 +1,138 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdexcept>
+#include "snapshot_writer.h"
+
+
+snapshot_writer::snapshot_writer(unsigned int max_pending) {
+
+	m_max_pending = max_pending;
+	m_pending = 0;
+	m_written = 0;
+	m_dropped = 0;
+	m_started = 0;
+	m_stop = 0;
+	pthread_mutex_init(&m_mutex, 0);
+	pthread_cond_init(&m_cond, 0);
+}
+
+
+/*
+ * Whatever is queued is written before this returns.
+ */
+snapshot_writer::~snapshot_writer() {
+
+	if(m_started) {
+		pthread_mutex_lock(&m_mutex);
+		m_stop = 1;
+		pthread_cond_signal(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+		pthread_join(m_thread, 0);
+	}
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+
+/*
+ * Queues samples to be written to filename; they are swapped out, leaving
+ * samples empty.  Returns -1 if the snapshot was dropped.
+ */
+int snapshot_writer::write(const std::string &filename, std::vector<std::complex<float> > &samples) {
+
+	unsigned int bytes = samples.size() * sizeof(std::complex<float>);
+	snapshot *s;
+
+	pthread_mutex_lock(&m_mutex);
+	if(m_pending + bytes > m_max_pending) {
+		m_dropped += 1;
+		pthread_mutex_unlock(&m_mutex);
+		samples.clear();
+		return -1;
+	}
+	if(!m_started) {
+		if(pthread_create(&m_thread, 0, start, this)) {
+			pthread_mutex_unlock(&m_mutex);
+			throw std::runtime_error("error: snapshot_writer: cannot create thread");
+		}
+		m_started = 1;
+	}
+	s = new snapshot;
+	s->filename = filename;
+	s->samples.swap(samples);
+	m_queue.push_back(s);
+	m_pending += bytes;
+	pthread_cond_signal(&m_cond);
+	pthread_mutex_unlock(&m_mutex);
+	return 0;
+}
+
+
+unsigned long long snapshot_writer::written() {
+
+	unsigned long long n;
+
+	pthread_mutex_lock(&m_mutex);
+	n = m_written;
+	pthread_mutex_unlock(&m_mutex);
+	return n;
+}
+
+
+unsigned long long snapshot_writer::dropped() {
+
+	unsigned long long n;
+
+	pthread_mutex_lock(&m_mutex);
+	n = m_dropped;
+	pthread_mutex_unlock(&m_mutex);
+	return n;
+}
+
+
+void *snapshot_writer::start(void *arg) {
+
+	((snapshot_writer *)arg)->run();
+	return 0;
+}
+
+
+void snapshot_writer::run() {
+
+	snapshot *s;
+	FILE *fp;
+	int ok;
+
+	pthread_mutex_lock(&m_mutex);
+	for(;;) {
+		while(m_queue.empty() && !m_stop)
+			pthread_cond_wait(&m_cond, &m_mutex);
+		if(m_queue.empty())
+			break;
+		s = m_queue.front();
+		m_queue.pop_front();
+		pthread_mutex_unlock(&m_mutex);
+
+		// the disk is only touched with the lock dropped
+		ok = 0;
+		if((fp = fopen(s->filename.c_str(), "w"))) {
+			ok = s->samples.empty() || fwrite(&s->samples[0], sizeof(std::complex<float>), s->samples.size(), fp) == s->samples.size();
+			if(fclose(fp))
+				ok = 0;
+		}
+		if(!ok)
+			fprintf(stderr, "error: snapshot_writer: cannot write %s\n", s->filename.c_str());
+
+		pthread_mutex_lock(&m_mutex);
+		m_pending -= s->samples.size() * sizeof(std::complex<float>);
+		if(ok)
+			m_written += 1;
+		else
+			m_dropped += 1;
+		delete s;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
@@ -0,0 +1,53 @@
+#ifndef INCLUDED_SNAPSHOT_WRITER_H
+#define INCLUDED_SNAPSHOT_WRITER_H
+
+/*
+ * snapshot_writer
+ *
+ * Writes stretches of raw input to files on a thread of its own, so the
+ * demodulator hands over samples it has already copied out of its ring and
+ * goes straight back to work.  The thread is started by the first write().
+ * A snapshot that would leave more than max_pending bytes waiting is dropped
+ * rather than making the demodulator wait on the disk.
+ */
+
+#include <pthread.h>
+#include <complex>
+#include <deque>
+#include <string>
+#include <vector>
+
+class snapshot_writer {
+public:
+	snapshot_writer(unsigned int max_pending = 64 << 20);
+	~snapshot_writer();
+
+	int write(const std::string &filename, std::vector<std::complex<float> > &samples);
+	unsigned long long written();
+	unsigned long long dropped();
+
+private:
+	struct snapshot {
+		std::string			filename;
+		std::vector<std::complex<float> > samples;
+	};
+
+	static void *start(void *arg);
+	void run();
+
+	std::deque<snapshot *>	m_queue;
+	unsigned int		m_max_pending;	// bytes
+	unsigned int		m_pending;	// bytes queued or being written
+	unsigned long long	m_written;
+	unsigned long long	m_dropped;	// queue full, or the file could not be written
+	int			m_started;
+	int			m_stop;
+
+	pthread_t		m_thread;
+	pthread_mutex_t		m_mutex;
+	pthread_cond_t		m_cond;
+
+	snapshot_writer(const snapshot_writer &);
+	snapshot_writer &operator=(const snapshot_writer &);
+};
+#endif /* INCLUDED_SNAPSHOT_WRITER_H */
@@ -0,0 +1,96 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdexcept>
+#include "trace_ring.h"
+
+
+trace_ring::trace_ring(unsigned int len) {
+
+	for(m_len = 1; m_len < len; m_len <<= 1)
+		;
+	m_mask = m_len - 1;
+	m_head = 0;
+
+	if(!(m_ring = new trace_event[m_len])) {
+		throw std::runtime_error("error: cannot create trace ring");
+	}
+	memset(m_ring, 0, m_len * sizeof(*m_ring));
+}
+
+
+trace_ring::~trace_ring() {
+
+	delete[] m_ring;
+}
+
+
+/*
+ * Copy out the events still in the ring, oldest first.  Safe to call while
+ * the writer is running.
+ */
+unsigned int trace_ring::snapshot(std::vector<trace_event> &events) {
+
+	unsigned long head, now, over;
+	unsigned int i, n;
+
+	head = m_head;
+	TRACE_BARRIER();
+	n = (head < m_len)? head : m_len;
+
+	events.clear();
+	for(i = 0; i < n; i++)
+		events.push_back(m_ring[(head - n + i) & m_mask]);
+
+	/*
+	 * Anything the writer has since lapped may be torn, and so may the slot
+	 * it is filling.  The difference is taken modulo the word, so it holds
+	 * across a wrap; across add()'s skip it is m_len too many, and all is
+	 * dropped.
+	 */
+	TRACE_BARRIER();
+	now = m_head;
+	over = now - head + 1 + n;
+	if(over > m_len) {
+		over -= m_len;
+		if(over > n)
+			over = n;
+		events.erase(events.begin(), events.begin() + over);
+	}
+
+	return events.size();
+}
+
+
+void trace_ring::dump(FILE *fp, const char *reason) {
+
+	static const char *type_name[] = {"run", "start", "end", "trigger"};
+
+	std::vector<trace_event> events;
+	unsigned int i;
+	const trace_event *e;
+
+	snapshot(events);
+	fprintf(fp, "trace: %s (%u events)\n", reason, (unsigned int)events.size());
+	for(i = 0; i < events.size(); i++) {
+		e = &events[i];
+		fprintf(fp, "%12llu %-7s", e->sample, (e->type < sizeof(type_name) / sizeof(*type_name))? type_name[e->type] : "?");
+		switch(e->type) {
+			case TRACE_RUN:
+				fprintf(fp, " %s %6u", e->level? "high" : "low ", e->width);
+				if(e->code < 0)
+					fprintf(fp, " rejected");
+				else
+					fprintf(fp, " %4.1f symbols", e->code / 2.0);
+				break;
+
+			case TRACE_BURST_END:
+				fprintf(fp, " %u symbols", e->width);
+				break;
+		}
+		fprintf(fp, "\tthreshold %g\n", e->threshold);
+	}
+	fflush(fp);
+}
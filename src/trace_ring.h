@@ -0,0 +1,73 @@
+#ifndef INCLUDED_TRACE_RING_H
+#define INCLUDED_TRACE_RING_H
+
+/*
+ * trace_ring
+ *
+ * Flight recorder for the slicer.  The demodulator thread is the only writer
+ * and never waits: an event is a few stores and an increment of m_head, and
+ * old events are overwritten.  A reader on any thread copies the ring and
+ * then drops whatever the writer may have overwritten during the copy.
+ *
+ * There must be only one writer, since add() is not atomic.  m_head is an
+ * unsigned long, one machine word, so a reader never sees half of a store to
+ * it, on 32-bit targets too.  It wraps there after 2^32 events.
+ */
+
+#include <stdio.h>
+#include <vector>
+
+typedef enum {
+	TRACE_RUN,			// run handed to slice() and how it was classified
+	TRACE_BURST_START,
+	TRACE_BURST_END,		// width is the number of symbols
+	TRACE_TRIGGER			// dump requested by the demodulator
+} trace_type;
+
+struct trace_event {
+	unsigned long long	sample;		// sample number when recorded
+	float			threshold;	// slicing threshold then
+	unsigned int		width;		// run width in samples
+	short			code;		// width in half-symbols, or -1 if rejected
+	unsigned char		type;		// trace_type
+	unsigned char		level;		// run was high
+};
+
+// x86 keeps stores in order; elsewhere a full barrier
+#if defined(__i386__) || defined(__x86_64__)
+#define TRACE_BARRIER()	__asm__ __volatile__("" ::: "memory")
+#else
+#define TRACE_BARRIER()	__sync_synchronize()
+#endif
+
+class trace_ring {
+public:
+	trace_ring(unsigned int len = 4096);
+	~trace_ring();
+
+	inline void add(int type, unsigned long long sample, float threshold, unsigned int width, int code, int level) {
+
+		trace_event *e = &m_ring[m_head & m_mask];
+
+		e->sample = sample;
+		e->threshold = threshold;
+		e->width = width;
+		e->code = code;
+		e->type = type;
+		e->level = level;
+		TRACE_BARRIER();
+
+		// a wrap goes on to m_len, the same slot, so a full ring never looks empty
+		m_head = (m_head + 1)? m_head + 1 : m_len;
+	}
+
+	unsigned int snapshot(std::vector<trace_event> &events);
+	void dump(FILE *fp, const char *reason);
+
+private:
+	trace_event *		m_ring;
+	unsigned int		m_len;		// power of 2
+	unsigned int		m_mask;
+	volatile unsigned long	m_head;		// events added, modulo the word; only add() writes it
+};
+#endif /* INCLUDED_TRACE_RING_H */
@@ -9,19 +9,97 @@
 
 GR_SWIG_BLOCK_MAGIC(omnipod, demod);
 
-omnipod_demod_sptr omnipod_make_demod(double clock_speed = 64e6, unsigned int decimation = 256);
+struct omnipod_stats {
+        unsigned long long samples;
+        unsigned long long transitions;
+        unsigned long long rejected;
+        unsigned long long bursts_started;
+        unsigned long long bursts_finished;
+        unsigned long long bursts_truncated;
+        unsigned long long bursts_timed_out;
+        unsigned long long buffer_grows;
+        unsigned long long errors_phase;
+        unsigned long long errors_impossible;
+        unsigned long long errors_unknown;
+        unsigned long long preamble_hits;
+        unsigned long long preamble_misses;
+        unsigned long long frames_checked;
+        unsigned long long frames_invalid;
+        unsigned long long repeat_lookups;
+        unsigned long long repeats;
+        unsigned long long repeat_evictions;
+        unsigned long long messages_complete;
+        unsigned long long messages_incomplete;
+        unsigned long long message_gaps;
+        unsigned long long message_out_of_order;
+        unsigned long long snapshots;
+        unsigned long long snapshots_dropped;
+        double represent_time;
+        unsigned long long work_calls;
+        double work_time;
+        double worst_call;
+        unsigned long long worst_call_items;
+        double recent_rtf;
+        unsigned long long lag_warnings;
+        unsigned long long backlog_warnings;
+};
+
+struct omnipod_levels {
+        float mean;
+        float peak;
+        float high;
+        float low;
+        float noise;
+        float snr;
+};
+
+// the arrays by index: runs of 1 - 6 symbols, half-symbols 0.5, 1.5, 2.5
+%extend omnipod_stats {
+        unsigned long long run(unsigned int symbols) {
+                return (symbols < 7)? self->runs[symbols] : 0;
+        }
+        unsigned long long half_run(unsigned int symbols) {
+                return (symbols < 3)? self->half_runs[symbols] : 0;
+        }
+}
+
+omnipod_demod_sptr omnipod_make_demod(double clock_speed = 64e6, unsigned int decimation = 256, int short_input = 0);
 
 class omnipod_demod : public gr_block {
 
 public:
         void set_representation(int rep);
+        void set_threshold(int threshold);
         void set_output(char *filename);
         void set_capture(char *filename);
         void show_hex();
         void show_power();
         void show_samples();
+        omnipod_stats get_stats();
+        omnipod_levels burst_levels();
+        void set_stats_file(char *filename, double interval);
+        void monitor_realtime(double max_backlog);
+        double latency(int stage, double p);
+        unsigned long long latency_count();
+        void reset_latency();
+        void dump_trace(char *filename);
+        void set_trace_file(char *filename);
+        void snapshot(char *filename, double seconds);
+        void set_snapshot(char *filename, double seconds);
+        void set_frame_check(char *spec);
+        void set_invalid_output(char *filename);
+        void set_repeat_window(double seconds);
+        void set_reassembly(double timeout);
+        void set_burst_timeout(double symbols);
+        void set_max_burst(double seconds);
+        void add_representation(int rep, char *filename);
+        int profile_enabled();
+        unsigned long long profile_ticks(int stage);
+        unsigned long long profile_calls(int stage);
+        void reset_profile();
+        void dump_profile(char *filename);
 
 private:
-        omnipod_demod(double clock_speed, unsigned int decimation);
+        omnipod_demod(double clock_speed, unsigned int decimation, int short_input);
 };
 